@@ -0,0 +1,136 @@
+﻿#include <chrono>
+#include <coroutine>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "TLSFAllocator.hpp"
+#include "TLSFCoroutine.hpp"
+
+// lazily started task whose frame comes from TLSFAllocator when
+// std::allocator_arg is passed, and from global operator new otherwise
+struct Task
+{
+    struct promise_type : TLSFPromiseAllocator<TLSFAllocator<>>
+    {
+        uint64_t value = 0;
+
+        Task get_return_object() { return Task{ std::coroutine_handle<promise_type>::from_promise(*this) }; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_value(uint64_t v) { value = v; }
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    explicit Task(std::coroutine_handle<promise_type> h)
+        : handle(h)
+    {
+    }
+    Task(Task&& other) noexcept
+        : handle(other.handle)
+    {
+        other.handle = nullptr;
+    }
+    Task& operator=(Task&& other) noexcept
+    {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+    ~Task()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    uint64_t run()
+    {
+        handle.resume();
+        return handle.promise().value;
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+Task work(uint64_t seed)
+{
+    uint64_t local[8];
+    for (uint64_t i = 0; i < 8; ++i)
+    {
+        local[i] = seed * (i + 1);
+    }
+    co_return local[seed % 8];
+}
+
+Task work(std::allocator_arg_t, TLSFAllocator<>&, uint64_t seed)
+{
+    uint64_t local[8];
+    for (uint64_t i = 0; i < 8; ++i)
+    {
+        local[i] = seed * (i + 1);
+    }
+    co_return local[seed % 8];
+}
+
+template <typename Spawn>
+void runBench(const char* name, uint32_t num, uint32_t inFlight, Spawn spawn)
+{
+    using Clock = std::chrono::steady_clock;
+
+    // keep a window of suspended coroutines alive so the frames do not
+    // simply reuse the same address every time
+    std::vector<Task> window;
+    window.reserve(inFlight);
+
+    uint64_t sum     = 0;
+    const auto begin = Clock::now();
+    for (uint32_t i = 0; i < num; ++i)
+    {
+        if (window.size() < inFlight)
+        {
+            window.emplace_back(spawn(i));
+            continue;
+        }
+
+        auto& slot = window[i % inFlight];
+        sum += slot.run();
+        slot = spawn(i);
+    }
+    for (auto& task : window)
+    {
+        sum += task.run();
+    }
+    window.clear();
+    const auto end = Clock::now();
+
+    const double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+    std::cout << std::left << std::setw(20) << name << std::setw(10) << inFlight << std::right << std::setw(12) << std::fixed
+              << std::setprecision(1) << ns / num << std::setw(14) << ns / 1e6 << "   (" << sum % 10 << ")\n";
+}
+
+int main()
+{
+    constexpr uint32_t memorySize = 16u << 20;
+    constexpr uint32_t num        = 5000000;
+    std::byte* memory             = new std::byte[memorySize];
+    std::memset(memory, 0, memorySize);
+
+    TLSFAllocator<> allocator(memory, memorySize / 2);
+    TLSFAllocator<> deferredAllocator(memory + memorySize / 2, memorySize / 2);
+    deferredAllocator.setDeferredCoalescing(256u << 10);
+
+    std::cout << std::left << std::setw(20) << "allocator" << std::setw(10) << "in flight" << std::right << std::setw(12)
+              << "ns/spawn" << std::setw(14) << "total ms" << "\n";
+    for (uint32_t inFlight : { 1u, 64u, 4096u })
+    {
+        runBench("operator new", num, inFlight, [](uint64_t i) { return work(i); });
+        runBench("TLSFAllocator", num, inFlight, [&](uint64_t i) { return work(std::allocator_arg, allocator, i); });
+        runBench("TLSF deferred", num, inFlight, [&](uint64_t i) { return work(std::allocator_arg, deferredAllocator, i); });
+    }
+
+    delete[] memory;
+    return 0;
+}
@@ -0,0 +1,146 @@
+﻿#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "TLSFAllocator.hpp"
+
+struct LatencyResult
+{
+    double mean;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+};
+
+LatencyResult summarize(std::vector<uint64_t>& samples)
+{
+    std::sort(samples.begin(), samples.end());
+
+    LatencyResult result{};
+    uint64_t sum = 0;
+    for (auto s : samples)
+    {
+        sum += s;
+    }
+    result.mean = static_cast<double>(sum) / samples.size();
+    result.p50  = samples[samples.size() / 2];
+    result.p99  = samples[samples.size() * 99 / 100];
+    result.p999 = samples[samples.size() * 999 / 1000];
+    result.max  = samples.back();
+    return result;
+}
+
+void printRow(const char* mode, const char* op, const LatencyResult& r)
+{
+    std::cout << std::left << std::setw(18) << mode << std::setw(12) << op << std::right
+              << std::setw(10) << std::fixed << std::setprecision(1) << r.mean
+              << std::setw(8) << r.p50 << std::setw(8) << r.p99 << std::setw(8) << r.p999
+              << std::setw(10) << r.max << "\n";
+}
+
+// churn workload: a live set of blocks where every free is immediately followed
+// by an allocation of the same size, plus a slowly drifting size mix
+void runChurn(const char* mode, uint32_t deferredBudget, uint32_t hotListLimit, std::byte* memory, uint32_t memorySize, uint32_t opNum)
+{
+    using Clock = std::chrono::steady_clock;
+
+    TLSFAllocator<> allocator(memory, memorySize);
+    allocator.setDeferredCoalescing(deferredBudget);
+    allocator.setHotSizeCache(hotListLimit);
+
+    std::mt19937 engine(42);
+    const uint32_t hotSizes[] = { 48, 200, 640, 4096 };
+    std::uniform_int_distribution<uint32_t> hotDist(0, 3);
+    std::uniform_int_distribution<uint32_t> coldDist(16, 8192);
+
+    struct Live
+    {
+        std::byte* p;
+        uint32_t size;
+    };
+    std::vector<Live> live(4096);
+    for (auto& l : live)
+    {
+        l.size = hotSizes[hotDist(engine)];
+        l.p    = allocator.allocate(l.size);
+    }
+
+    std::vector<uint64_t> allocSamples;
+    std::vector<uint64_t> freeSamples;
+    allocSamples.reserve(opNum);
+    freeSamples.reserve(opNum);
+
+    std::uniform_int_distribution<size_t> slotDist(0, live.size() - 1);
+    const auto begin = Clock::now();
+    for (uint32_t i = 0; i < opNum; ++i)
+    {
+        auto& l = live[slotDist(engine)];
+
+        auto t0 = Clock::now();
+        allocator.deallocate(l.p);
+        auto t1 = Clock::now();
+
+        // 70% of the requests reuse the size that was just freed, the rest
+        // switch to another hot size or to a random cold size
+        const uint32_t dice = engine() % 10;
+        if (dice == 7 || dice == 8 || l.size > 4096)
+        {
+            l.size = hotSizes[hotDist(engine)];
+        }
+        else if (dice == 9)
+        {
+            l.size = coldDist(engine);
+        }
+
+        auto t2 = Clock::now();
+        l.p     = allocator.allocate(l.size);
+        auto t3 = Clock::now();
+
+        if (!l.p)
+        {
+            std::cerr << "allocation failed in " << mode << "\n";
+            return;
+        }
+        std::memset(l.p, 0xa5, 8);
+
+        freeSamples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        allocSamples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(t3 - t2).count());
+    }
+    const auto end = Clock::now();
+
+    for (auto& l : live)
+    {
+        allocator.deallocate(l.p);
+    }
+
+    printRow(mode, "deallocate", summarize(freeSamples));
+    printRow(mode, "allocate", summarize(allocSamples));
+    std::cout << std::left << std::setw(18) << mode << std::setw(12) << "total ms" << std::right << std::setw(10)
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000.0 << "\n";
+}
+
+int main()
+{
+    constexpr uint32_t memorySize = 64u << 20;
+    constexpr uint32_t opNum      = 2000000;
+    std::byte* memory             = new std::byte[memorySize];
+    std::memset(memory, 0, memorySize);  // fault the pages in before measuring
+
+    std::cout << std::left << std::setw(18) << "mode" << std::setw(12) << "op" << std::right << std::setw(10) << "mean ns"
+              << std::setw(8) << "p50" << std::setw(8) << "p99" << std::setw(8) << "p99.9" << std::setw(10) << "max" << "\n";
+
+    runChurn("eager", 0, 0, memory, memorySize, opNum);
+    runChurn("deferred 64KiB", 64u << 10, 0, memory, memorySize, opNum);
+    runChurn("deferred 1MiB", 1u << 20, 0, memory, memorySize, opNum);
+    runChurn("deferred 16MiB", 16u << 20, 0, memory, memorySize, opNum);
+    runChurn("hot lists 64", 0, 64, memory, memorySize, opNum);
+    runChurn("hot lists 1024", 0, 1024, memory, memorySize, opNum);
+
+    delete[] memory;
+    return 0;
+}
@@ -0,0 +1,82 @@
+﻿#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "TLSFAllocator.hpp"
+#include "Workload.hpp"
+
+// usage: FitPolicyBench [--record <dir>] [trace files...]
+// without trace files a set of synthetic traces is generated; --record writes
+// them out so the same workload can be replayed later
+template <class FitPolicy>
+void runTrace(const char* policyName, const Trace& trace, std::byte* memory, uint32_t memorySize)
+{
+    TLSFAllocator<4, FitPolicy> allocator(memory, memorySize);
+
+    // warm up once, then measure
+    replayTrace(allocator, trace, memory);
+    allocator.clearAll();
+    const auto result = replayTrace(allocator, trace, memory);
+
+    std::cout << std::left << std::setw(24) << trace.name << std::setw(10) << policyName << std::right
+              << std::setw(10) << std::fixed << std::setprecision(1) << result.nsPerOp
+              << std::setw(10) << result.failed
+              << std::setw(14) << result.peakLive
+              << std::setw(14) << result.peakFootprint
+              << std::setw(10) << std::setprecision(3) << static_cast<double>(result.peakFootprint) / result.peakLive << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    constexpr uint32_t memorySize = 64u << 20;
+    std::byte* memory             = new std::byte[memorySize];
+    std::memset(memory, 0, memorySize);
+
+    std::vector<Trace> traces;
+    std::string recordDir;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            recordDir = argv[++i];
+            continue;
+        }
+
+        Trace trace;
+        if (!loadTrace(argv[i], trace))
+        {
+            std::cerr << "failed to load trace : " << argv[i] << "\n";
+            return 1;
+        }
+        traces.emplace_back(std::move(trace));
+    }
+
+    if (traces.empty())
+    {
+        traces.emplace_back(makeRandomTrace("small 16-512", 1, 2000000, 20000, 16, 512));
+        traces.emplace_back(makeRandomTrace("medium 256-16K", 2, 2000000, 2000, 256, 16384));
+        traces.emplace_back(makeRandomTrace("wide 16-256K", 3, 1000000, 300, 16, 262144));
+
+        if (!recordDir.empty())
+        {
+            const char* files[] = { "small.trace", "medium.trace", "wide.trace" };
+            for (size_t i = 0; i < traces.size(); ++i)
+            {
+                saveTrace(recordDir + "/" + files[i], traces[i]);
+            }
+        }
+    }
+
+    std::cout << std::left << std::setw(24) << "trace" << std::setw(10) << "policy" << std::right << std::setw(10) << "ns/op"
+              << std::setw(10) << "failed" << std::setw(14) << "peak live" << std::setw(14) << "footprint"
+              << std::setw(10) << "ratio" << "\n";
+
+    for (const auto& trace : traces)
+    {
+        runTrace<TLSFGoodFit>("good fit", trace, memory, memorySize);
+        runTrace<TLSFBestFit>("best fit", trace, memory, memorySize);
+    }
+
+    delete[] memory;
+    return 0;
+}
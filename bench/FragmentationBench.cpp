@@ -0,0 +1,110 @@
+﻿#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "TLSFAllocator.hpp"
+#include "Workload.hpp"
+
+// usage: FragmentationBench [ops per workload] [csv path]
+// runs long synthetic workloads and samples the heap shape over time.
+// the CSV has one row per sample:
+//   workload,phase,ops,live_bytes,used_bytes,free_bytes,free_blocks,largest_free,
+//   external_fragmentation,footprint,ns_per_op,failed
+// external_fragmentation is 1 - largest_free / free_bytes, and ns_per_op covers
+// the whole loop including the workload generator
+void runWorkload(SyntheticWorkload workload, std::byte* memory, uint32_t memorySize, uint64_t opNum, uint64_t sampleInterval, std::ostream& csv)
+{
+    using Clock = std::chrono::steady_clock;
+
+    TLSFAllocator<> allocator(memory, memorySize);
+
+    std::vector<std::byte*> pointers;
+    std::vector<uint32_t> sizes;
+    uint64_t live   = 0;
+    uint64_t failed = 0;
+
+    auto intervalBegin = Clock::now();
+    for (uint64_t i = 1; i <= opNum; ++i)
+    {
+        TraceOp op;
+        workload.next(op);
+        if (op.id >= pointers.size())
+        {
+            pointers.resize(op.id + 1, nullptr);
+            sizes.resize(op.id + 1, 0);
+        }
+
+        if (op.kind == TraceOp::Allocate)
+        {
+            std::byte* p = allocator.allocate(op.size);
+            if (p)
+            {
+                p[0] = std::byte{ 1 };
+                live += op.size;
+            }
+            else
+            {
+                ++failed;
+            }
+            pointers[op.id] = p;
+            sizes[op.id]    = op.size;
+        }
+        else if (pointers[op.id])
+        {
+            allocator.deallocate(pointers[op.id]);
+            pointers[op.id] = nullptr;
+            live -= sizes[op.id];
+        }
+
+        if (i % sampleInterval == 0)
+        {
+            const auto intervalEnd = Clock::now();
+            const double nsPerOp   = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(intervalEnd - intervalBegin).count()) / sampleInterval;
+
+            const auto stats              = allocator.getStatistics();
+            const double externalFragment = stats.freeSize ? 1.0 - static_cast<double>(stats.maxFreeSize) / stats.freeSize : 0.0;
+
+            csv << workload.name() << "," << workload.phaseIndex() << "," << i << "," << live << "," << stats.usedSize << ","
+                << stats.freeSize << "," << stats.freeBlockNum << "," << stats.maxFreeSize << "," << externalFragment << ","
+                << stats.footprint << "," << nsPerOp << "," << failed << "\n";
+
+            // keep the statistics walk out of the measured time
+            intervalBegin = Clock::now();
+        }
+    }
+
+    const auto stats = allocator.getStatistics();
+    std::cerr << workload.name() << " : ops " << opNum << ", failed " << failed << ", free blocks " << stats.freeBlockNum
+              << ", largest free " << stats.maxFreeSize << " / free " << stats.freeSize << ", footprint " << stats.footprint << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    constexpr uint32_t memorySize = 256u << 20;
+    constexpr uint64_t liveLimit  = 160u << 20;
+    const uint64_t opNum          = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000000;
+    const uint64_t sampleInterval = opNum / 500 ? opNum / 500 : 1;
+
+    std::ofstream file;
+    if (argc > 2)
+    {
+        file.open(argv[2]);
+        if (!file)
+        {
+            std::cerr << "failed to open : " << argv[2] << "\n";
+            return 1;
+        }
+    }
+    std::ostream& csv = argc > 2 ? file : std::cout;
+
+    std::byte* memory = new std::byte[memorySize];
+    std::memset(memory, 0, memorySize);
+
+    csv << "workload,phase,ops,live_bytes,used_bytes,free_bytes,free_blocks,largest_free,external_fragmentation,footprint,ns_per_op,failed\n";
+    runWorkload(makeWebServerWorkload(1, liveLimit), memory, memorySize, opNum, sampleInterval, csv);
+    runWorkload(makeGameWorkload(2, liveLimit), memory, memorySize, opNum, sampleInterval, csv);
+    runWorkload(makeDatabaseWorkload(3, liveLimit), memory, memorySize, opNum, sampleInterval, csv);
+
+    delete[] memory;
+    return 0;
+}
@@ -0,0 +1,179 @@
+﻿#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "TLSFAllocator.hpp"
+#include "Workload.hpp"
+
+// usage: LifetimeHintBench [--ops <n>] [--short <ops>] [trace files...]
+// replays each trace twice: with plain allocate(size) and with
+// allocate(size, TLSFLifetimeHint). the hint comes from the trace itself:
+// a block freed within --short ops of its allocation is Short, every other
+// block is Long, which stands in for a caller that knows its call sites.
+//
+//   ns/op       : whole replay, statistics sampling excluded
+//   span        : peak of the pool bytes outside the largest free block, short-lived
+//                 blocks sit at the top of the pool so the highest offset in use says little
+//   ext frag    : average of 1 - largest_free / free_bytes over the run
+//   free blocks : average number of free blocks over the run
+struct HintResult
+{
+    double nsPerOp         = 0;
+    uint64_t failed        = 0;
+    uint64_t peakSpan      = 0;
+    double fragmentation   = 0;
+    double freeBlockNum    = 0;
+};
+
+// lifetime hint of every allocate op, in op order
+std::vector<TLSFLifetimeHint> makeHints(const Trace& trace, uint64_t shortLifetime)
+{
+    std::vector<TLSFLifetimeHint> hints(trace.ops.size(), TLSFLifetimeHint::Long);
+    std::vector<size_t> allocateIndex(trace.idNum, 0);
+    for (size_t i = 0; i < trace.ops.size(); ++i)
+    {
+        const auto& op = trace.ops[i];
+        if (op.kind == TraceOp::Allocate)
+        {
+            allocateIndex[op.id] = i;
+        }
+        else if (i - allocateIndex[op.id] < shortLifetime)
+        {
+            hints[allocateIndex[op.id]] = TLSFLifetimeHint::Short;
+        }
+    }
+    return hints;
+}
+
+HintResult runTrace(const Trace& trace, const std::vector<TLSFLifetimeHint>* hints, std::byte* memory, uint32_t memorySize)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr size_t kSampleNum = 200;
+    const size_t interval       = trace.ops.size() / kSampleNum ? trace.ops.size() / kSampleNum : 1;
+
+    TLSFAllocator<> allocator(memory, memorySize);
+
+    HintResult result;
+    std::vector<std::byte*> pointers(trace.idNum, nullptr);
+    uint32_t sampleNum = 0;
+    Clock::duration elapsed{};
+
+    auto intervalBegin = Clock::now();
+    for (size_t i = 0; i < trace.ops.size(); ++i)
+    {
+        const auto& op = trace.ops[i];
+        if (op.kind == TraceOp::Allocate)
+        {
+            std::byte* p = hints ? allocator.allocate(op.size, (*hints)[i]) : allocator.allocate(op.size);
+            if (!p)
+            {
+                ++result.failed;
+                continue;
+            }
+
+            p[0]            = std::byte{ 1 };
+            pointers[op.id] = p;
+        }
+        else if (pointers[op.id])
+        {
+            allocator.deallocate(pointers[op.id]);
+            pointers[op.id] = nullptr;
+        }
+
+        if ((i + 1) % interval == 0)
+        {
+            elapsed += Clock::now() - intervalBegin;
+
+            const auto stats = allocator.getStatistics();
+            result.fragmentation += stats.freeSize ? 1.0 - static_cast<double>(stats.maxFreeSize) / stats.freeSize : 0.0;
+            result.freeBlockNum += stats.freeBlockNum;
+            result.peakSpan = std::max(result.peakSpan, stats.usedSize + stats.freeSize - stats.maxFreeSize);
+            ++sampleNum;
+
+            // keep the statistics walk out of the measured time
+            intervalBegin = Clock::now();
+        }
+    }
+    elapsed += Clock::now() - intervalBegin;
+
+    for (auto* p : pointers)
+    {
+        if (p)
+        {
+            allocator.deallocate(p);
+        }
+    }
+
+    if (sampleNum)
+    {
+        result.fragmentation /= sampleNum;
+        result.freeBlockNum /= sampleNum;
+    }
+    result.nsPerOp = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / trace.ops.size();
+    return result;
+}
+
+void printResult(const Trace& trace, const char* placement, const HintResult& result)
+{
+    std::cout << std::left << std::setw(18) << trace.name << std::setw(10) << placement << std::right
+              << std::setw(10) << std::fixed << std::setprecision(1) << result.nsPerOp
+              << std::setw(10) << result.failed
+              << std::setw(14) << result.peakSpan
+              << std::setw(10) << std::setprecision(3) << result.fragmentation
+              << std::setw(14) << std::setprecision(0) << result.freeBlockNum << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    constexpr uint32_t memorySize = 256u << 20;
+    constexpr uint64_t liveLimit  = 160u << 20;
+    uint64_t opNum                = 4000000;
+    uint64_t shortLifetime        = 10000;
+
+    std::vector<Trace> traces;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--ops") == 0 && i + 1 < argc)
+        {
+            opNum = std::strtoull(argv[++i], nullptr, 10);
+            continue;
+        }
+        if (std::strcmp(argv[i], "--short") == 0 && i + 1 < argc)
+        {
+            shortLifetime = std::strtoull(argv[++i], nullptr, 10);
+            continue;
+        }
+
+        Trace trace;
+        if (!loadTrace(argv[i], trace))
+        {
+            std::cerr << "failed to load trace : " << argv[i] << "\n";
+            return 1;
+        }
+        traces.emplace_back(std::move(trace));
+    }
+
+    if (traces.empty())
+    {
+        traces.emplace_back(makeTrace(makeWebServerWorkload(1, liveLimit), opNum));
+        traces.emplace_back(makeTrace(makeGameWorkload(2, liveLimit), opNum));
+        traces.emplace_back(makeTrace(makeDatabaseWorkload(3, liveLimit), opNum));
+    }
+
+    std::byte* memory = new std::byte[memorySize];
+    std::memset(memory, 0, memorySize);
+
+    std::cout << std::left << std::setw(18) << "trace" << std::setw(10) << "placement" << std::right << std::setw(10) << "ns/op"
+              << std::setw(10) << "failed" << std::setw(14) << "span" << std::setw(10) << "ext frag"
+              << std::setw(14) << "free blocks" << "\n";
+
+    for (const auto& trace : traces)
+    {
+        const auto hints = makeHints(trace, shortLifetime);
+        printResult(trace, "none", runTrace(trace, nullptr, memory, memorySize));
+        printResult(trace, "hinted", runTrace(trace, &hints, memory, memorySize));
+    }
+
+    delete[] memory;
+    return 0;
+}
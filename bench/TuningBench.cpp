@@ -0,0 +1,234 @@
+﻿#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "TLSFAllocator.hpp"
+#include "Workload.hpp"
+
+// usage: TuningBench [--ops <n>] [trace files...]
+// replays each trace against TLSFAllocator<3> .. <6>, each with the default
+// and a larger minimum block size, and recommends the configuration with the
+// best footprint x time product. without trace files the random traces of
+// FitPolicyBench and the synthetic web-server / game / database workloads
+// (--ops steps each) are used.
+//
+//   ns/op     : time of the second replay (the first one warms up)
+//   footprint : peak of the highest pool offset in use
+//   ext frag  : average of 1 - largest_free / free_bytes over the run
+//   overhead  : average of used_bytes / live_bytes - 1 (headers, rounding, split limits)
+struct TuningResult
+{
+    double nsPerOp         = 0;
+    uint64_t failed        = 0;
+    uint64_t peakFootprint = 0;
+    double fragmentation   = 0;
+    double overhead        = 0;
+};
+
+struct HeapShape
+{
+    double fragmentation = 0;
+    double overhead      = 0;
+};
+
+// replays the trace again and samples the statistics, kept apart from the timed replay
+template <class Allocator>
+HeapShape sampleHeapShape(Allocator& allocator, const Trace& trace)
+{
+    constexpr size_t kSampleNum = 200;
+    const size_t interval       = trace.ops.size() / kSampleNum ? trace.ops.size() / kSampleNum : 1;
+
+    std::vector<std::byte*> pointers(trace.idNum, nullptr);
+    std::vector<uint32_t> sizes(trace.idNum, 0);
+    uint64_t live = 0;
+
+    HeapShape shape;
+    uint32_t sampleNum = 0;
+    for (size_t i = 0; i < trace.ops.size(); ++i)
+    {
+        const auto& op = trace.ops[i];
+        if (op.kind == TraceOp::Allocate)
+        {
+            if (std::byte* p = allocator.allocate(op.size))
+            {
+                pointers[op.id] = p;
+                sizes[op.id]    = op.size;
+                live += op.size;
+            }
+        }
+        else if (pointers[op.id])
+        {
+            allocator.deallocate(pointers[op.id]);
+            pointers[op.id] = nullptr;
+            live -= sizes[op.id];
+        }
+
+        if ((i + 1) % interval == 0 && live)
+        {
+            const auto stats = allocator.getStatistics();
+            shape.fragmentation += stats.freeSize ? 1.0 - static_cast<double>(stats.maxFreeSize) / stats.freeSize : 0.0;
+            shape.overhead += static_cast<double>(stats.usedSize) / live - 1.0;
+            ++sampleNum;
+        }
+    }
+
+    for (auto* p : pointers)
+    {
+        if (p)
+        {
+            allocator.deallocate(p);
+        }
+    }
+
+    if (sampleNum)
+    {
+        shape.fragmentation /= sampleNum;
+        shape.overhead /= sampleNum;
+    }
+    return shape;
+}
+
+template <uint32_t kSplitNum, uint32_t kMinBlockSize>
+TuningResult runConfig(const Trace& trace, std::byte* memory, uint32_t memorySize)
+{
+    TLSFAllocator<kSplitNum, TLSFGoodFit, kMinBlockSize> allocator(memory, memorySize);
+
+    // warm up once, then measure
+    replayTrace(allocator, trace, memory);
+    allocator.clearAll();
+    const auto replay = replayTrace(allocator, trace, memory);
+
+    allocator.clearAll();
+    const auto shape = sampleHeapShape(allocator, trace);
+
+    TuningResult result;
+    result.nsPerOp       = replay.nsPerOp;
+    result.failed        = replay.failed;
+    result.peakFootprint = replay.peakFootprint;
+    result.fragmentation = shape.fragmentation;
+    result.overhead      = shape.overhead;
+    return result;
+}
+
+struct TuningConfig
+{
+    const char* name;
+    TuningResult (*run)(const Trace&, std::byte*, uint32_t);
+};
+
+const TuningConfig kConfigs[] = {
+    { "TLSFAllocator<3>", runConfig<3, 8> },
+    { "TLSFAllocator<3, TLSFGoodFit, 64>", runConfig<3, 64> },
+    { "TLSFAllocator<4>", runConfig<4, 16> },
+    { "TLSFAllocator<4, TLSFGoodFit, 64>", runConfig<4, 64> },
+    { "TLSFAllocator<5>", runConfig<5, 32> },
+    { "TLSFAllocator<5, TLSFGoodFit, 64>", runConfig<5, 64> },
+    { "TLSFAllocator<6>", runConfig<6, 64> },
+    { "TLSFAllocator<6, TLSFGoodFit, 128>", runConfig<6, 128> },
+};
+constexpr size_t kConfigNum = sizeof(kConfigs) / sizeof(kConfigs[0]);
+
+int main(int argc, char** argv)
+{
+    constexpr uint32_t memorySize = 256u << 20;
+    constexpr uint64_t liveLimit  = 160u << 20;
+    uint64_t opNum                = 2000000;
+
+    std::vector<Trace> traces;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--ops") == 0 && i + 1 < argc)
+        {
+            opNum = std::strtoull(argv[++i], nullptr, 10);
+            continue;
+        }
+
+        Trace trace;
+        if (!loadTrace(argv[i], trace))
+        {
+            std::cerr << "failed to load trace : " << argv[i] << "\n";
+            return 1;
+        }
+        traces.emplace_back(std::move(trace));
+    }
+
+    if (traces.empty())
+    {
+        traces.emplace_back(makeRandomTrace("small 16-512", 1, 2000000, 20000, 16, 512));
+        traces.emplace_back(makeRandomTrace("medium 256-16K", 2, 2000000, 2000, 256, 16384));
+        traces.emplace_back(makeRandomTrace("wide 16-256K", 3, 1000000, 300, 16, 262144));
+        traces.emplace_back(makeTrace(makeWebServerWorkload(1, liveLimit), opNum));
+        traces.emplace_back(makeTrace(makeGameWorkload(2, liveLimit), opNum));
+        traces.emplace_back(makeTrace(makeDatabaseWorkload(3, liveLimit), opNum));
+    }
+
+    std::byte* memory = new std::byte[memorySize];
+    std::memset(memory, 0, memorySize);
+
+    std::cout << std::left << std::setw(18) << "trace" << std::setw(36) << "configuration" << std::right << std::setw(10) << "ns/op"
+              << std::setw(10) << "failed" << std::setw(14) << "footprint" << std::setw(10) << "ext frag"
+              << std::setw(10) << "overhead" << std::setw(10) << "score" << "\n";
+
+    // score of a configuration on one trace: (footprint / best footprint) x (ns/op / best ns/op),
+    // a configuration that fails any allocation the others satisfy is not recommended
+    double logScores[kConfigNum] = {};
+    bool rejected[kConfigNum]    = {};
+    for (const auto& trace : traces)
+    {
+        TuningResult results[kConfigNum];
+        for (size_t i = 0; i < kConfigNum; ++i)
+        {
+            results[i] = kConfigs[i].run(trace, memory, memorySize);
+        }
+
+        double bestNs          = INFINITY;
+        uint64_t bestFootprint = UINT64_MAX;
+        uint64_t leastFailed   = UINT64_MAX;
+        for (const auto& result : results)
+        {
+            bestNs        = std::min(bestNs, result.nsPerOp);
+            bestFootprint = std::min(bestFootprint, result.peakFootprint);
+            leastFailed   = std::min(leastFailed, result.failed);
+        }
+
+        for (size_t i = 0; i < kConfigNum; ++i)
+        {
+            const auto& result = results[i];
+            const double score = (static_cast<double>(result.peakFootprint) / bestFootprint) * (result.nsPerOp / bestNs);
+            logScores[i] += std::log(score);
+            rejected[i] = rejected[i] || result.failed > leastFailed;
+
+            std::cout << std::left << std::setw(18) << trace.name << std::setw(36) << kConfigs[i].name << std::right
+                      << std::setw(10) << std::fixed << std::setprecision(1) << result.nsPerOp
+                      << std::setw(10) << result.failed
+                      << std::setw(14) << result.peakFootprint
+                      << std::setw(10) << std::setprecision(3) << result.fragmentation
+                      << std::setw(10) << result.overhead
+                      << std::setw(10) << score << "\n";
+        }
+    }
+
+    // geometric mean of the per-trace scores, 1.0 means best on every trace
+    std::cout << "\n" << std::left << std::setw(36) << "configuration" << std::right << std::setw(10) << "score" << "\n";
+    size_t recommended = kConfigNum;
+    for (size_t i = 0; i < kConfigNum; ++i)
+    {
+        const double score = std::exp(logScores[i] / traces.size());
+        std::cout << std::left << std::setw(36) << kConfigs[i].name << std::right << std::setw(10) << std::setprecision(3) << score
+                  << (rejected[i] ? "  (failed allocations)" : "") << "\n";
+
+        if (!rejected[i] && (recommended == kConfigNum || logScores[i] < logScores[recommended]))
+        {
+            recommended = i;
+        }
+    }
+
+    if (recommended < kConfigNum)
+    {
+        std::cout << "\nrecommended : " << kConfigs[recommended].name << "\n";
+    }
+
+    delete[] memory;
+    return 0;
+}
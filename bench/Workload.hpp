@@ -0,0 +1,362 @@
+﻿#ifndef _TLSFALLOCATOR_BENCH_WORKLOAD_HPP_
+#define _TLSFALLOCATOR_BENCH_WORKLOAD_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <fstream>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+// one step of an allocation trace
+// trace files are plain text, one op per line:
+//   a <id> <size>   allocate size bytes and remember the pointer as id
+//   f <id>          free the pointer remembered as id
+struct TraceOp
+{
+    enum Kind : uint8_t
+    {
+        Allocate,
+        Free,
+    };
+
+    Kind kind;
+    uint32_t id;
+    uint32_t size;
+};
+
+struct Trace
+{
+    std::string name;
+    std::vector<TraceOp> ops;
+    uint32_t idNum = 0;
+};
+
+inline bool loadTrace(const std::string& path, Trace& trace)
+{
+    std::ifstream ifs(path);
+    if (!ifs)
+    {
+        return false;
+    }
+
+    trace.name = path;
+    trace.ops.clear();
+    trace.idNum = 0;
+
+    char kind;
+    uint32_t id;
+    while (ifs >> kind >> id)
+    {
+        TraceOp op{};
+        op.id = id;
+        if (kind == 'a')
+        {
+            op.kind = TraceOp::Allocate;
+            ifs >> op.size;
+        }
+        else
+        {
+            op.kind = TraceOp::Free;
+        }
+        trace.ops.push_back(op);
+        trace.idNum = std::max(trace.idNum, id + 1);
+    }
+
+    return true;
+}
+
+inline bool saveTrace(const std::string& path, const Trace& trace)
+{
+    std::ofstream ofs(path);
+    if (!ofs)
+    {
+        return false;
+    }
+
+    for (const auto& op : trace.ops)
+    {
+        if (op.kind == TraceOp::Allocate)
+        {
+            ofs << "a " << op.id << " " << op.size << "\n";
+        }
+        else
+        {
+            ofs << "f " << op.id << "\n";
+        }
+    }
+
+    return true;
+}
+
+// random alloc/free mix over a bounded live set, sizes uniform in [minSize, maxSize]
+inline Trace makeRandomTrace(const char* name, uint32_t seed, uint32_t opNum, uint32_t maxLive, uint32_t minSize, uint32_t maxSize)
+{
+    Trace trace;
+    trace.name = name;
+
+    std::mt19937 engine(seed);
+    std::uniform_int_distribution<uint32_t> sizeDist(minSize, maxSize);
+    std::vector<uint32_t> live;
+
+    for (uint32_t i = 0; i < opNum; ++i)
+    {
+        if (live.size() < maxLive && (live.empty() || engine() % 2))
+        {
+            const uint32_t id = trace.idNum++;
+            trace.ops.push_back({ TraceOp::Allocate, id, sizeDist(engine) });
+            live.push_back(id);
+        }
+        else
+        {
+            const size_t index = engine() % live.size();
+            trace.ops.push_back({ TraceOp::Free, live[index], 0 });
+            live[index] = live.back();
+            live.pop_back();
+        }
+    }
+
+    for (auto id : live)
+    {
+        trace.ops.push_back({ TraceOp::Free, id, 0 });
+    }
+
+    return trace;
+}
+
+// one phase of a synthetic workload
+struct WorkloadPhase
+{
+    uint64_t length;        // allocations in this phase
+    uint32_t minSize;       // power-law (Pareto) size distribution
+    uint32_t maxSize;
+    double sizeAlpha;       // smaller alpha -> heavier tail
+    double shortRatio;      // probability that a block is short-lived
+    double shortLifetime;   // mean lifetime in allocations (exponential)
+    double longLifetime;
+};
+
+// lifetime-driven workload generated on the fly, so it can run for far
+// longer than a recorded trace would fit in memory
+// every allocation advances the clock by one tick; blocks are freed when
+// their lifetime expires, or earliest-deadline-first when the live bytes
+// would exceed liveLimit. phases repeat in order
+class SyntheticWorkload
+{
+public:
+    SyntheticWorkload(const char* name, uint32_t seed, std::vector<WorkloadPhase> phases, uint64_t liveLimit)
+        : mName(name)
+        , mEngine(seed)
+        , mPhases(std::move(phases))
+        , mLiveLimit(liveLimit)
+    {
+    }
+
+    const char* name() const { return mName; }
+    uint32_t phaseIndex() const { return static_cast<uint32_t>(mPhaseIndex); }
+
+    // ids are recycled, so the id space stays bounded by the peak live count
+    uint32_t idNum() const { return static_cast<uint32_t>(mSizes.size()); }
+
+    void next(TraceOp& op)
+    {
+        // free expired blocks first
+        if (!mDeaths.empty() && (mDeaths.top().tick <= mTick || mPendingSize + mLive > mLiveLimit))
+        {
+            const auto death = mDeaths.top();
+            mDeaths.pop();
+            mLive -= mSizes[death.id];
+            mFreeIds.push_back(death.id);
+
+            op = { TraceOp::Free, death.id, 0 };
+            return;
+        }
+
+        const auto& phase = mPhases[mPhaseIndex];
+        if (mPendingSize == 0)
+        {
+            mPendingSize = sampleSize(phase);
+            if (mPendingSize + mLive > mLiveLimit && !mDeaths.empty())
+            {
+                next(op);
+                return;
+            }
+        }
+
+        uint32_t id;
+        if (!mFreeIds.empty())
+        {
+            id = mFreeIds.back();
+            mFreeIds.pop_back();
+        }
+        else
+        {
+            id = static_cast<uint32_t>(mSizes.size());
+            mSizes.push_back(0);
+        }
+
+        const bool isShort      = std::uniform_real_distribution<double>(0, 1)(mEngine) < phase.shortRatio;
+        const double meanLife   = isShort ? phase.shortLifetime : phase.longLifetime;
+        const uint64_t lifetime = 1 + static_cast<uint64_t>(std::exponential_distribution<double>(1.0 / meanLife)(mEngine));
+
+        mSizes[id] = mPendingSize;
+        mLive += mPendingSize;
+        mDeaths.push({ mTick + lifetime, id });
+        op           = { TraceOp::Allocate, id, mPendingSize };
+        mPendingSize = 0;
+
+        ++mTick;
+        if (++mPhaseTick >= phase.length)
+        {
+            mPhaseTick  = 0;
+            mPhaseIndex = (mPhaseIndex + 1) % mPhases.size();
+        }
+    }
+
+private:
+    struct Death
+    {
+        uint64_t tick;
+        uint32_t id;
+
+        bool operator>(const Death& other) const { return tick > other.tick; }
+    };
+
+    uint32_t sampleSize(const WorkloadPhase& phase)
+    {
+        // inverse transform sampling of a Pareto distribution
+        const double u    = std::uniform_real_distribution<double>(0, 1)(mEngine);
+        const double size = phase.minSize / std::pow(1.0 - u, 1.0 / phase.sizeAlpha);
+        return size > phase.maxSize ? phase.maxSize : static_cast<uint32_t>(size);
+    }
+
+    const char* mName;
+    std::mt19937_64 mEngine;
+    std::vector<WorkloadPhase> mPhases;
+    size_t mPhaseIndex   = 0;
+    uint64_t mPhaseTick  = 0;
+    uint64_t mTick       = 0;
+    uint64_t mLive       = 0;
+    uint64_t mLiveLimit;
+    uint32_t mPendingSize = 0;
+    std::vector<uint32_t> mSizes;
+    std::vector<uint32_t> mFreeIds;
+    std::priority_queue<Death, std::vector<Death>, std::greater<Death>> mDeaths;
+};
+
+// workloads shaped after common server / game / database allocation patterns
+inline SyntheticWorkload makeWebServerWorkload(uint32_t seed, uint64_t liveLimit)
+{
+    return SyntheticWorkload("web-server", seed,
+        {
+            // steady traffic: small request buffers, a few long-lived sessions
+            { 2000000, 32, 65536, 1.3, 0.97, 2000, 2000000 },
+            // burst: more and larger buffers alive at the same time
+            { 500000, 64, 262144, 1.0, 0.99, 20000, 2000000 },
+        },
+        liveLimit);
+}
+
+inline SyntheticWorkload makeGameWorkload(uint32_t seed, uint64_t liveLimit)
+{
+    return SyntheticWorkload("game", seed,
+        {
+            // level load: big long-lived assets
+            { 20000, 4096, 4u << 20, 0.8, 0.1, 5000, 3000000 },
+            // gameplay: per-frame scratch allocations
+            { 3000000, 16, 8192, 1.5, 0.995, 500, 3000000 },
+        },
+        liveLimit);
+}
+
+inline SyntheticWorkload makeDatabaseWorkload(uint32_t seed, uint64_t liveLimit)
+{
+    return SyntheticWorkload("database", seed,
+        {
+            // mixed cache entries and index nodes with heavy-tailed lifetimes
+            { 3000000, 64, 262144, 1.1, 0.6, 50000, 5000000 },
+            // bulk load: many medium long-lived rows
+            { 500000, 256, 16384, 1.2, 0.2, 50000, 10000000 },
+        },
+        liveLimit);
+}
+
+// records the first opNum steps of a synthetic workload as a trace
+inline Trace makeTrace(SyntheticWorkload workload, uint64_t opNum)
+{
+    Trace trace;
+    trace.name = workload.name();
+    trace.ops.resize(opNum);
+    for (auto& op : trace.ops)
+    {
+        workload.next(op);
+    }
+    trace.idNum = workload.idNum();
+    return trace;
+}
+
+struct ReplayResult
+{
+    double nsPerOp         = 0;
+    uint64_t failed        = 0;  // allocations that returned nullptr
+    uint64_t peakLive      = 0;  // peak of requested live bytes
+    uint64_t peakFootprint = 0;  // peak of the highest pool offset in use
+};
+
+// replays a trace against an allocator with allocate(uint32_t) / deallocate(void*)
+template <class Allocator>
+ReplayResult replayTrace(Allocator& allocator, const Trace& trace, const std::byte* poolBegin)
+{
+    using Clock = std::chrono::steady_clock;
+
+    ReplayResult result;
+    std::vector<std::byte*> pointers(trace.idNum, nullptr);
+    std::vector<uint32_t> sizes(trace.idNum, 0);
+    uint64_t live = 0;
+
+    const auto begin = Clock::now();
+    for (const auto& op : trace.ops)
+    {
+        if (op.kind == TraceOp::Allocate)
+        {
+            std::byte* p = allocator.allocate(op.size);
+            if (!p)
+            {
+                ++result.failed;
+                continue;
+            }
+
+            p[0]            = std::byte{ 1 };
+            pointers[op.id] = p;
+            sizes[op.id]    = op.size;
+            live += op.size;
+            result.peakLive      = std::max(result.peakLive, live);
+            result.peakFootprint = std::max<uint64_t>(result.peakFootprint, (p - poolBegin) + op.size);
+        }
+        else if (pointers[op.id])
+        {
+            allocator.deallocate(pointers[op.id]);
+            pointers[op.id] = nullptr;
+            live -= sizes[op.id];
+        }
+    }
+    const auto end = Clock::now();
+
+    // leave the allocator empty for the next run
+    for (auto* p : pointers)
+    {
+        if (p)
+        {
+            allocator.deallocate(p);
+        }
+    }
+
+    result.nsPerOp = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / trace.ops.size();
+    return result;
+}
+
+#endif
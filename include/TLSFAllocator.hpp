@@ -1,13 +1,33 @@
-template<uint32_t kSplitNum = 4>
-class TLSFAllocator;
-
-
 #ifndef _HEADER_ONLY_TLSFALLOCATOR_HPP_
 #define _HEADER_ONLY_TLSFALLOCATOR_HPP_
 
 #include <cstddef>
 #include <cstdint>
 #include <cassert>
+#include <cstring>
+#include <new>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// Kj: vTCỸTCYт֐؂グĒT (ubN͕K܂)
+struct TLSFGoodFit
+{
+    static constexpr bool kSearchExactClass = false;
+};
+
+// Kj: vTCYƓTCYтɒHĒT (fЉ})
+struct TLSFBestFit
+{
+    static constexpr bool kSearchExactClass = true;
+};
+
+// kMinBlockSize͕ōubN̍ŏ̊ǗTCY (1 << kSplitNumȏ)
+template<uint32_t kSplitNum = 4, class FitPolicy = TLSFGoodFit, uint32_t kMinBlockSize = (1u << kSplitNum)>
+class TLSFAllocator;
 
 // BoundaryBlockpwb_
 class BoundaryBlockHeader
@@ -125,31 +145,188 @@ public:
 class TLSFBlockHeader : public BoundaryBlockHeader
 {
 public:
+    uint32_t dirtySize;  // t[ubN̊Ǘ̂擪珑܂ꂽ\oCg (ȍ~̓[)
     TLSFBlockHeader* pre;
     TLSFBlockHeader* next;
     bool used;
+    uint8_t tag;  // mۂTuVXẽ^O (gpubN̂ݗL)
+    uint32_t handle;  // nhŊmۂubNȂnh (0ȂړłȂ)
 
     TLSFBlockHeader()
-        : pre(nullptr)
+        : dirtySize(0xffffffff)
+        , pre(nullptr)
         , next(nullptr)
-        , used(false) {}
+        , used(false)
+        , tag(0)
+        , handle(0) {}
+};
+
+// 󋵂̓v
+struct TLSFStatistics
+{
+    uint64_t usedSize = 0;      // gpubN̊ǗTCYv (x܂)
+    uint64_t freeSize = 0;      // t[ubN̊ǗTCYv
+    uint64_t deferredSize = 0;  // xXgɐς܂ĂTCY
+    uint64_t hotCachedSize = 0; // poTCỸXgɐς܂ĂTCY
+    uint64_t footprint = 0;     // v[擪Ō̎gpubN̏I[܂ł̃oCg
+    uint32_t usedBlockNum = 0;
+    uint32_t freeBlockNum = 0;
+    uint32_t maxFreeSize = 0;   // ԑ傫t[ubN̊ǗTCY
+};
+
+// allocateAtLeast()̌ (std::allocation_resultƓ)
+struct TLSFAllocationResult
+{
+    std::byte* ptr;
+    uint32_t count;  // gĂ悢oCg (vTCYȏ)
+};
+
+// Ǘ (v[) ̏, v[擪̔ԕubN̊Ǘɒu
+struct TLSFPoolInfo
+{
+    TLSFPoolInfo* next;
+    uint32_t size;  // ԕubN܂߂v[Ŝ̃oCg
+};
+
+// \zIvV
+enum TLSFOption : uint32_t
+{
+    kTLSFOptionNone = 0,
+    kTLSFControlInPool = 1 << 0,  // ubNǗ̐擪ɒu
+    kTLSFZeroedMemory = 1 << 1,   // n̓[NAς (mmapȂ)
 };
 
+// 蓖ĂubN̎̌
+// Z̓t[ubŇ (wildernessȂǗ̖) , ͑O؂o
+// ubN̋󂫂̃ubN̊ԂɎU΂Ȃ悤ɂ
+enum class TLSFLifetimeHint : uint8_t
+{
+    Unknown,  // wȂ (O؂o)
+    Short,    // 
+    Long,     // g (g񂵂̃LbṼubN͎gȂ)
+};
+
+// ubN
+// 擪̃LbVCFL/SLrbg}bvu, ̃LbVCt[XgƒxXg̐擪ׂ
+// kSplitNum <= 4Ȃrbg}bv1C, ŐĜ̓rbg}bvƃXg擪2C
+template<uint32_t kSplitNum>
+struct alignas(64) TLSFControlBlock
+{
+    static_assert(kSplitNum >= 1 && kSplitNum <= 6, "kSplitNum must be in [1, 6]");
+
+    // SLrbg}bv (1 << kSplitNum rbg)
+    using SLBitmap = std::conditional_t<(kSplitNum <= 3), uint8_t,
+                     std::conditional_t<(kSplitNum == 4), uint16_t,
+                     std::conditional_t<(kSplitNum == 5), uint32_t, uint64_t>>>;
+
+    // FLIkSplitNum~31͈̔
+    static constexpr uint32_t kFLNum = 32 - kSplitNum;
+
+    uint32_t flBitmap;
+    SLBitmap slBitmap[kFLNum];
+
+    // t[Xg擪̔z (xXg̐擪̌ɑ)
+    BoundaryBlock<TLSFBlockHeader>** getBlockArray()
+    {
+        return reinterpret_cast<BoundaryBlock<TLSFBlockHeader>**>(this + 1);
+    }
+
+    // Xg擪܂Ŋ܂߂ubNŜ̃TCY
+    static size_t getAllSize(uint32_t blockArraySize)
+    {
+        return sizeof(TLSFControlBlock) + sizeof(BoundaryBlock<TLSFBlockHeader>*) * blockArraySize * 2;
+    }
+};
 
-template<uint32_t kSplitNum = 4>
+template<uint32_t kSplitNum, class FitPolicy, uint32_t kMinBlockSize>
 class TLSFAllocator
 {
+    static_assert(kSplitNum > 4 || sizeof(TLSFControlBlock<kSplitNum>) == 64, "bitmaps must fit in one cache line");
+    static_assert(kMinBlockSize >= (1u << kSplitNum), "blocks smaller than 1 << kSplitNum have no free list");
+
 public:
+    // Ǘ̃ACg (SubN̐擪ƊǗ̋Eɑ)
+    static constexpr uint32_t kAlignment = 16;
+    static_assert(sizeof(BoundaryBlock<TLSFBlockHeader>) % kAlignment == 0, "block header breaks alignment");
+
+    // v[擪̔ԕubN̊ǗTCY (TLSFPoolInfou)
+    static constexpr uint32_t kPoolHeadMemorySize = ((sizeof(TLSFPoolInfo) + sizeof(uint32_t) + kAlignment - 1) & ~(kAlignment - 1)) - sizeof(uint32_t);
+    // v[̔ԕubN̊ǗTCY
+    static constexpr uint32_t kPoolTailMemorySize = kAlignment - sizeof(uint32_t);
+    // O̔ԕubN̕v[獷oCg
+    static constexpr uint32_t kPoolOverhead = 2 * (sizeof(BoundaryBlock<TLSFBlockHeader>) + sizeof(uint32_t)) + kPoolHeadMemorySize + kPoolTailMemorySize;
+
+    // mێsɌĂ΂nh
+    // LbV̔jv[̒ǉȂǂŃ󂯂trueԂƊmۂĎs
+    // 󂯂̂falseԂ, ̃nh֐i
+    // trueԂĂĎskFailureRetryNum񎸔s, ̃nh͒߂Ď֐i
+    // (sizẽubN邾󂯂邱. GoodFitł͎̃TCYт܂Ő؂グĒT)
+    using FailureHandler = bool (*)(TLSFAllocator& allocator, uint32_t size, void* userData);
+    static constexpr uint32_t kFailureHandlerNum = 8;
+    static constexpr uint32_t kFailureRetryNum = 4;
+
+    // ^O̐ (^O0͎w肵ȂmۂɎg)
+    static constexpr uint32_t kTagNum = 16;
+
+    // poTCY̐pXg̐, px𐔂JE^̐ (TCỸnbVŒڈ)
+    static constexpr uint32_t kHotSizeNum = 4;
+    static constexpr uint32_t kSizeCounterNum = 64;
+    // ̉񐔂̊mۂƂɕpoTCYIђ
+    static constexpr uint32_t kHotSizeEpoch = 4096;
+
+    // ړ\ȃubÑnh (0͖)
+    using Handle = uint32_t;
+    static constexpr Handle kInvalidHandle = 0;
+
+    // ȏ̃[NA̓LbVȂ悤non-temporalXgAōs
+    static constexpr uint32_t kStreamClearSize = 256 * 1024;
+
     TLSFAllocator() = delete;
 
     // RXgN^
-    TLSFAllocator(std::byte* mainMemory, uint32_t byteSize)
-    : mMemory(mainMemory)
-        , mMaxSize(byteSize - sizeof(TLSFBlockHeader) - sizeof(uint32_t))
-        , mAllSize(byteSize)
-        , mBlockArraySize((static_cast<uint32_t>(getMSB(mMaxSize)) - kSplitNum + 1)* (1ul << kSplitNum))
+    // kTLSFControlInPoolw肷ƐubNmainMemory̐擪ɒu, cǗ
+    // kTLSFZeroedMemoryw肷allocateZeroed()͈xgĂȂ̈NAȂ
+    TLSFAllocator(std::byte* mainMemory, uint32_t byteSize, uint32_t option = kTLSFOptionNone)
+    : mMemory(option & kTLSFControlInPool ? getPoolMemory(mainMemory, byteSize) : alignPointer(mainMemory, kAlignment))
+        , mMaxSize(((byteSize - static_cast<uint32_t>(mMemory - mainMemory)) & ~(kAlignment - 1)) - kPoolOverhead - sizeof(TLSFBlockHeader) - sizeof(uint32_t))
+        , mAllSize((byteSize - static_cast<uint32_t>(mMemory - mainMemory)) & ~(kAlignment - 1))
+        , mBlockArraySize(getBlockArraySize(byteSize))
+        , mControlInPool(option & kTLSFControlInPool)
+        , mDeferredBudget(0)
+        , mWilderness(nullptr)
+        , mHotListLimit(0)
+        , mHotSizeNum(0)
+        , mHotEpochCount(0)
+        , mSizeCounters()
+        , mHotLists()
+        , mFailureHandlerNum(0)
+        , mTags()
+        , mHandleTable(nullptr)
+        , mHandleCapacity(0)
+        , mHandleFreeList(kInvalidHandle)
+        , mCompactPool(nullptr)
+        , mCompactCursor(nullptr)
+        , mCompactMoved(false)
+        , mParent(nullptr)
+        , mParentTag(0)
+        , mGrowSize(0)
     {
-        mBlockArray = new BoundaryBlock<TLSFBlockHeader>*[mBlockArraySize];
+        std::byte* control = nullptr;
+        if (mControlInPool)
+        {
+            control = alignControl(mainMemory);
+        }
+        else
+        {
+            control = static_cast<std::byte*>(::operator new(TLSFControlBlock<kSplitNum>::getAllSize(mBlockArraySize), std::align_val_t(alignof(TLSFControlBlock<kSplitNum>))));
+        }
+
+        mControl = new (control) TLSFControlBlock<kSplitNum>();
+        mBlockArray = mControl->getBlockArray();
+        mDeferredArray = mBlockArray + mBlockArraySize;
+        mPoolList = initPool(mMemory, mAllSize);
+        mWildernessEnd = getPoolTail(mPoolList);
+        resetPool(mPoolList)->header.dirtySize = option & kTLSFZeroedMemory ? 0 : 0xffffffff;
         clearAll();
     }
 
@@ -165,133 +342,98 @@ public:
         }
 #endif
 
-        delete[] mBlockArray;
-    }
-
-    // 
-    std::byte* allocate(uint32_t size)
-    {
-        if (size < 0)
-        {
-            assert(!"invalid allocation size!");
-            return nullptr;
-        }
-        if (size < (1ul << kSplitNum))
+        // qq[vȂeǉ`NԂ (ŏ̗͎̈gƈꏏdestroyChild()ŕԂ)
+        if (mParent)
         {
-            assert(!"too small size!");
-            size = 1ul << kSplitNum;
+            for (TLSFPoolInfo* info = mPoolList->next; info;)
+            {
+                TLSFPoolInfo* next = info->next;
+                mParent->deallocate(getPoolHead(info));
+                info = next;
+            }
         }
 
-        if (size > mMaxSize)
+        if (!mControlInPool)
         {
-            assert(!"requested size is over max size!");
-            return nullptr;
+            ::operator delete(mControl, std::align_val_t(alignof(TLSFControlBlock<kSplitNum>)));
         }
+    }
 
-        const uint32_t FLI = getMSB(size);
-        uint32_t SLI = getSecondLevel(size, FLI, kSplitNum);
+    //  (tag̗\Z𒴂ꍇnullptr)
+    std::byte* allocate(uint32_t size, uint8_t tag = 0)
+    {
+        auto* block = allocateTaggedBlock(size, tag);
+        return block ? reinterpret_cast<std::byte*>(block->getMemory()) : nullptr;
+    }
 
-        BoundaryBlock<TLSFBlockHeader>* target = mBlockArray[getBlockArrayIndex(FLI, SLI)];
+    // ݂̌w肵Ċ蓖Ă
+    std::byte* allocate(uint32_t size, TLSFLifetimeHint hint, uint8_t tag = 0)
+    {
+        auto* block = allocateTaggedBlock(size, tag, kAlignment, hint);
+        return block ? reinterpret_cast<std::byte*>(block->getMemory()) : nullptr;
+    }
 
-        TLSFBlockHeader* header = nullptr;
-        if (target)
+    // [NÄ蓖Ă ([̂܂܂ƕĂ镔͏܂Ȃ)
+    std::byte* allocateZeroed(uint32_t size, uint8_t tag = 0)
+    {
+        auto* block = allocateTaggedBlock(size, tag);
+        if (!block)
         {
-            header = &target->header;
-
-            for (size_t i = 0; header->next && header->used; ++i)
-            {
-                header = header->next;
-            }
+            return nullptr;
         }
 
-        if (!target || !header || header->used)  // ̊KwŒT
-        {
-            target = reinterpret_cast<BoundaryBlock<TLSFBlockHeader>*>(header);
-
-            uint32_t freeListBit = 0;
-            for (uint32_t i = 0; i < (1ul << kSplitNum); ++i)
-            {
-                if (mBlockArray[getBlockArrayIndex(FLI, i)])
-                {
-                    TLSFBlockHeader* h = &mBlockArray[getBlockArrayIndex(FLI, i)]->header;
-                    for (size_t index = 0; h->next && h->used; ++index)
-                    {
-                        h = h->next;
-                    }
+        clearMemory(reinterpret_cast<std::byte*>(block->getMemory()), block->header.dirtySize);
+        return reinterpret_cast<std::byte*>(block->getMemory());
+    }
 
-                    if (!h->used)
-                    {
-                        freeListBit |= 1 << i;
-                    }
-                }
-            }
+    // vTCYȏ̗̈蓖, ؂グ╪̒[܂߂ĎgoCgԂ
+    TLSFAllocationResult allocateAtLeast(uint32_t size, uint8_t tag = 0)
+    {
+        auto* block = allocateTaggedBlock(size, tag);
+        if (!block)
+        {
+            return { nullptr, 0 };
+        }
 
-            uint32_t newSLI = getFreeListSLI(SLI, freeListBit);
-            if (newSLI == -1)  // second levelɂ͂Ȃ
-            {
-                uint32_t newFLI = getFreeListFLI(FLI, mAllFLI);
+        return { reinterpret_cast<std::byte*>(block->getMemory()), block->getMemorySize() };
+    }
 
-                if (newFLI == -1)  // SȂ
-                {
-                    assert(!"failed to allocate!");
-                    return nullptr;
-                }
+    // 蓖Ă̈ŎgoCgwb_擾
+    uint32_t usableSize(const void* address) const
+    {
+        assert(address || !"invalid address!");
+        auto* pBlock = reinterpret_cast<const BoundaryBlock<TLSFBlockHeader>*>(reinterpret_cast<const std::byte*>(address) - sizeof(TLSFBlockHeader));
+        assert(pBlock->header.used || !"not allocated address!");
+        return pBlock->getMemorySize();
+    }
 
-                // FLĨubN𕪊č쐬 
-                for (int i = (1 << kSplitNum) - 1; i >= 0; --i)
-                {
-                    auto* biggerBlock = mBlockArray[getBlockArrayIndex(newFLI, i)];
+    // ̃AP[^̊Ǘ̃AhX (ŏ̊Ǘ͔͈͔r, ǉv[̓XgH)
+    // qq[ṽv[͐ẽubNȂ̂ŐetrueԂ
+    bool owns(const void* address) const
+    {
+        auto* p = reinterpret_cast<const std::byte*>(address);
+        if (p >= mMemory && p < mMemory + mAllSize)
+        {
+            return true;
+        }
 
-                    if (biggerBlock && !biggerBlock->header.used)
-                    {
-                        if (!biggerBlock->enableSplit(size))
-                        {
-                            assert(!"falied to split biggest block!");
-                            return nullptr;
-                        }
-
-                        // AllFLI番Ƃ
-                        unregisterFLI(biggerBlock->getMemorySize());
-                        // ̂ŏ
-                        mBlockArray[getBlockArrayIndex(newFLI, i)] = nullptr;
-
-                        // 擾͕̂̂
-                        auto* splitted = biggerBlock->split(size);
-                        // ΏۃTCŶ̂𓖂Ă͂܂ꏊɃZbg
-                        mBlockArray[getBlockArrayIndex(FLI, SLI)] = biggerBlock;
-
-                        uint32_t splittedFLI = getMSB(splitted->getMemorySize());
-                        uint32_t splittedSLI = getSecondLevel(splitted->getMemorySize(), splittedFLI, kSplitNum);
-                        if (!mBlockArray[(newFLI - kSplitNum) * (1 << kSplitNum) + i])
-                        {
-                            mBlockArray[getBlockArrayIndex(splittedFLI, splittedSLI)] = splitted;
-                            splitted->header.used = false;
-                        }
-                        else
-                        {
-                            auto* header = &mBlockArray[getBlockArrayIndex(newFLI, i)]->header;
-                            auto* splittedHeader = &splitted->header;
-                            header->next = splittedHeader;
-                            splittedHeader->pre = header;
-                            splittedHeader->next = nullptr;
-                        }
-                        // VǉFLIo^
-                        registerFLI(splitted->getMemorySize());
-                        break;
-                    }
-                }
-            }
-            else
+        for (TLSFPoolInfo* info = mPoolList->next; info; info = info->next)
+        {
+            auto* head = reinterpret_cast<const std::byte*>(getPoolHead(info));
+            if (p >= head && p < head + info->size)
             {
-                SLI = newSLI;
+                return true;
             }
-
-            target = mBlockArray[getBlockArrayIndex(FLI, SLI)];
         }
+        return false;
+    }
 
-
-        target->header.used = true;
-        return reinterpret_cast<std::byte*>(target->getMemory());
+    // alignmentEɑĊ蓖Ă (alignment2̗ݏ)
+    std::byte* allocateAligned(uint32_t size, uint32_t alignment, uint8_t tag = 0)
+    {
+        assert((alignment & (alignment - 1)) == 0 || !"alignment must be power of 2!");
+        auto* block = allocateTaggedBlock(size, tag, alignment);
+        return block ? reinterpret_cast<std::byte*>(block->getMemory()) : nullptr;
     }
 
     // ̌^wVer.
@@ -317,240 +459,1470 @@ public:
             pBlock = reinterpret_cast<BoundaryBlock<TLSFBlockHeader>*>(p - sizeof(TLSFBlockHeader));
         }
 
-        pBlock->header.used = false;
         assert(reinterpret_cast<TLSFBlockHeader*>(pBlock) == &pBlock->header);
+        assert(pBlock->header.used || !"double free!");
+        assert(!pBlock->header.handle || !"use deallocateHandle()!");
 
-        removeBlockFromList(pBlock);
+        mTags[pBlock->header.tag].usedSize -= pBlock->getMemorySize();
+        releaseBlock(pBlock);
 
-        // ׂ͈͊OgpĂmergeȂ
-        const auto* right = reinterpret_cast<std::byte*>(pBlock->next());
-        const auto* left = reinterpret_cast<std::byte*>(pBlock->prev());
-        const bool isRightFree = right && right >= mMemory && right <= (mMemory + mAllSize) && !(pBlock->next()->header.used) && pBlock->next()->getMemorySize();
-        const bool isLeftFree = left && left <= (mMemory + mAllSize) && left >= mMemory && !(pBlock->prev()->header.used) && pBlock->prev()->getMemorySize();
+        return true;
+    }
 
-        if (isRightFree)  // E󂢂Ă̂Ń}[W
+    // ^OƂ̗\Zݒ肷 (gp̊ǗTCY̏, 0Ŗ)
+    bool setTagBudget(uint8_t tag, uint64_t budget)
+    {
+        if (tag >= kTagNum)
         {
-            removeBlockFromList(pBlock->next());
-
-            pBlock->merge();
+            assert(!"invalid tag!");
+            return false;
         }
 
-        // ̃ubN}[W
-        if (isLeftFree)
-        {
-            // ݂̃ubNAubNƓ
-            removeBlockFromList(pBlock->prev(), pBlock);
+        mTags[tag].budget = budget;
+        return true;
+    }
 
-            pBlock = pBlock->prev();
-            pBlock->merge();
+    // ^OƂ̎gp̊ǗTCY (x̃ubN͊܂܂Ȃ)
+    uint64_t getTagUsedSize(uint8_t tag) const
+    {
+        if (tag >= kTagNum)
+        {
+            assert(!"invalid tag!");
+            return 0;
         }
 
-        // ǂFLI, SLIɂ邩, ēo^
-        const uint32_t FLI = getMSB(pBlock->getMemorySize());
-        const uint32_t SLI = getSecondLevel(pBlock->getMemorySize(), FLI, kSplitNum);
+        return mTags[tag].usedSize;
+    }
 
-#ifndef NDEBUG
+    // ړ\ȃubN蓖ĂănhԂ (skInvalidHandle)
+    // gɐGƂpin()ŌŒ肷. Œ肵ĂȂubNcompactStep()ňړ
+    Handle allocateHandle(uint32_t size, uint8_t tag = 0)
+    {
+        if (!mHandleFreeList && !growHandleTable())
         {
-            auto* p = reinterpret_cast<std::byte*>(mBlockArray[getBlockArrayIndex(FLI, SLI)]);
-            assert(!p || !(p < mMemory || p > mMemory + mMaxSize) || !"invalid memory!!!");
+            return kInvalidHandle;
         }
-#endif
 
-        // }[WubNo^
-        if (!mBlockArray[getBlockArrayIndex(FLI, SLI)])
-        {
-            mBlockArray[getBlockArrayIndex(FLI, SLI)] = pBlock;
-        }
-        else
+        auto* block = allocateTaggedBlock(size, tag);
+        if (!block)
         {
-            auto* header = &mBlockArray[getBlockArrayIndex(FLI, SLI)]->header;
-            auto* newHeader = &pBlock->header;
-            header->next = newHeader;
-            newHeader->pre = header;
-            newHeader->next = nullptr;
+            return kInvalidHandle;
         }
 
-        registerFLI(pBlock->getMemorySize());
-
-        return true;
+        const Handle handle = mHandleFreeList;
+        auto& entry = mHandleTable[handle];
+        mHandleFreeList = entry.nextFree;
+        entry.block = block;
+        entry.pinCount = 0;
+        block->header.handle = handle;
+        return handle;
     }
 
-    //ׂĉZbg
-    void clearAll()
+    // nh̃ubN
+    void deallocateHandle(Handle handle)
     {
-        for (size_t i = 0; i < mBlockArraySize; ++i)
-        {
-            mBlockArray[i] = nullptr;
-        }
+        assert((handle && handle < mHandleCapacity && mHandleTable[handle].block) || !"invalid handle!");
+        auto& entry = mHandleTable[handle];
+        assert(!entry.pinCount || !"deallocating pinned handle!");
 
-        BoundaryBlock<TLSFBlockHeader>* block = new (mMemory) BoundaryBlock<TLSFBlockHeader>(mMaxSize);
-        mBlockArray[getBlockArrayIndex(getMSB(mMaxSize), 0)] = block;
-        mAllFLI = 1 << getMSB(mMaxSize);
+        auto* pBlock = entry.block;
+        pBlock->header.handle = kInvalidHandle;
+        deallocate(pBlock->getMemory());
+
+        entry.block = nullptr;
+        entry.nextFree = mHandleFreeList;
+        mHandleFreeList = handle;
     }
 
-    // ݂̊蓖ď󋵂dump
-    void dump()
+    // nh̃ubNŒ肵ĊǗԂ (unpin()܂ňړȂ)
+    std::byte* pin(Handle handle)
     {
-        const auto maxFLI = getMSB(mMaxSize);
-        const auto maxSLI = 1 << kSplitNum;
+        assert((handle && handle < mHandleCapacity && mHandleTable[handle].block) || !"invalid handle!");
+        auto& entry = mHandleTable[handle];
+        ++entry.pinCount;
+        return reinterpret_cast<std::byte*>(entry.block->getMemory());
+    }
 
-        std::cerr << "----------------dump-----------------\n";
-        for (size_t fli = 0; fli <= maxFLI; ++fli)
+    void unpin(Handle handle)
+    {
+        assert((handle && handle < mHandleCapacity && mHandleTable[handle].pinCount) || !"unpin without pin!");
+        --mHandleTable[handle].pinCount;
+    }
+
+    // Œ肳ĂȂnh̃ubN𒼑Ő󂫂֋l, 󂫂v[̌֊񂹂ă}[W
+    // 1͈̏ړoCgƒHubNł悻maxBytes܂. ȎĊJ
+    // 1ĉړȂfalseԂ
+    bool compactStep(uint32_t maxBytes)
+    {
+        int64_t budget = maxBytes;
+        while (budget > 0)
         {
-            for (size_t sli = 0; sli < maxSLI; ++sli)
+            if (!mCompactPool)  // ̎n
             {
-                std::cerr << (1ul << fli) + (1ul << fli) / (1ul << kSplitNum) * sli << "(" << fli << " , " << sli << ") : ";
-                auto* p = reinterpret_cast<std::byte*>(mBlockArray[getBlockArrayIndex(fli, sli)]);
-                if (!p)
-                {
-                    std::cerr << "null\n";
-                }
-                else if (p < mMemory || p >= mMemory + mAllSize)
-                {
-                    std::cerr << "invalid\n";
-                }
-                else
+                mCompactPool = mPoolList;
+                mCompactCursor = getPoolHead(mCompactPool)->next();
+                mCompactMoved = false;
+            }
+
+            budget -= sizeof(BoundaryBlock<TLSFBlockHeader>);
+            auto* block = mCompactCursor;
+            if (block == getPoolTail(mCompactPool))  // ̃v[
+            {
+                mCompactPool = mCompactPool->next;
+                if (!mCompactPool)
                 {
-                    std::cerr << "found\n";
+                    mCompactCursor = nullptr;
+                    return mCompactMoved;
                 }
+
+                mCompactCursor = getPoolHead(mCompactPool)->next();
+                continue;
             }
-        }
-        std::cerr << "----------------end of dump-----------------\n";
-    }
 
-private:
+            auto* next = block->next();
+            if (block->header.used || !isMovable(next))
+            {
+                mCompactCursor = next;
+                continue;
+            }
 
-    inline uint32_t getMSB(uint32_t data) const
-    {
-        if (data == 0)
-        {
-            return 0;
+            budget -= next->getMemorySize();
+            mCompactCursor = moveBlockDown(block, next);
+            mCompactMoved = true;
         }
 
-        uint32_t index = 0;
-        for (; data != 1; ++index)
+        return true;
+    }
+
+    // mێsnh𖖔ɓo^ (o^ɌĂ΂)
+    bool addFailureHandler(FailureHandler handler, void* userData = nullptr)
+    {
+        if (!handler || mFailureHandlerNum >= kFailureHandlerNum)
         {
-            data = data >> 1;
+            assert(!"failed to add failure handler!");
+            return false;
         }
 
-        return index;
+        mFailureHandlers[mFailureHandlerNum++] = { handler, userData };
+        return true;
     }
 
-    inline uint32_t getLSB(uint32_t data) const
+    // mێsnho^
+    bool removeFailureHandler(FailureHandler handler, void* userData = nullptr)
     {
-        uint32_t index = 0;
-        for (; data % 2 == 0; ++index)
+        for (uint32_t i = 0; i < mFailureHandlerNum; ++i)
         {
-            data = data >> 1;
+            if (mFailureHandlers[i].handler == handler && mFailureHandlers[i].userData == userData)
+            {
+                for (; i + 1 < mFailureHandlerNum; ++i)
+                {
+                    mFailureHandlers[i] = mFailureHandlers[i + 1];
+                }
+                --mFailureHandlerNum;
+                return true;
+            }
         }
 
-        return index;
+        return false;
     }
 
-    inline uint32_t getSecondLevel(uint32_t size, uint32_t MSB, uint32_t N) const
+    // Ǘǉ (mێsnh̒Ăł悢)
+    // ǉclearAll()łێ, ŏ̊Ǘ傫ubN͍Ȃ
+    // zeroedȂ烁̓[NAς݂ƂĈ
+    bool addPool(std::byte* memory, uint32_t byteSize, bool zeroed = false)
     {
-        // ŏʃrbg̃rbg񂾂Lɂ}XN
-        const uint32_t mask = (1 << MSB) - 1;  // 1000 0000 -> 0111 1111
+        std::byte* base = alignPointer(memory, kAlignment);
+        if (static_cast<uint32_t>(base - memory) >= byteSize)
+        {
+            assert(!"too small pool!");
+            return false;
+        }
 
-        // Eւ̃VtgZo
-        const uint32_t rs = MSB - N;  // 7 - 3 = 4 i8ȂN=3j
+        const uint32_t size = (byteSize - static_cast<uint32_t>(base - memory)) & ~(kAlignment - 1);
+        const uint64_t blockSize = static_cast<uint64_t>(kPoolOverhead) + sizeof(BoundaryBlock<TLSFBlockHeader>) + sizeof(uint32_t);
+        if (size < blockSize + kMinBlockSize || size - blockSize > mMaxSize)
+        {
+            assert(!"invalid pool size!");
+            return false;
+        }
 
-        // sizeɃ}XNāAEփVtg΃CfbNX
-        return (size & mask) >> rs;
+        TLSFPoolInfo* info = initPool(base, size);
+        info->next = mPoolList->next;
+        mPoolList->next = info;
+
+        auto* block = resetPool(info);
+        block->header.dirtySize = zeroed ? 0 : 0xffffffff;
+        insertBlockToList(block);
+        return true;
     }
 
-    inline uint32_t getFreeListSLI(uint32_t mySLI, uint32_t freeListBit)
+    // ̃q[v̈mۂĎqq[v
+    // qq[ṽIuWFNgƐubNmۂ̈ɒu, ȂȂgrowSize (0ȂbyteSize) eǉ
+    // ë̗tagŊmۂ. eȂnullptr
+    TLSFAllocator* createChild(uint32_t byteSize, uint32_t growSize = 0, uint8_t tag = 0)
     {
-        // SLIȏオĂrbg쐬 (ID = 0Ȃ0xffffffffj
-        uint32_t myBit = 0xffffffff << mySLI;
-
-        // myBitfreeListBit_ς΁Amۉ\ȃubNSLI
-        uint32_t enableListBit = freeListBit & myBit;
+        constexpr uint32_t objectSize = (sizeof(TLSFAllocator) + kAlignment - 1) & ~(kAlignment - 1);
+        if (byteSize > mMaxSize - objectSize)
+        {
+            assert(!"requested size is over max size!");
+            return nullptr;
+        }
 
-        // LSB߂Ίmۉ\ȈԃTCY̏t[XgubN̔
-        if (enableListBit == 0)
+        std::byte* memory = allocate(objectSize + byteSize, tag);
+        if (!memory)
         {
-            return -1;  // t[Xg
+            return nullptr;
         }
 
-        return getLSB(enableListBit);
+        auto* child = new (memory) TLSFAllocator(memory + objectSize, byteSize, kTLSFControlInPool);
+        child->mParent = this;
+        child->mParentTag = tag;
+        child->mGrowSize = growSize ? growSize : byteSize;
+        child->addFailureHandler(growFromParent);
+        return child;
     }
 
-    inline uint32_t getFreeListFLI(uint32_t myFLI, uint32_t globalFLI)
+    // qq[vjĐemۂׂ̈ĕԂ (`Nɔ)
+    static void destroyChild(TLSFAllocator* child)
     {
-        uint32_t myBit = 0xffffffff << myFLI;
-        uint32_t enableFLIBit = globalFLI & myBit;
-        if (enableFLIBit == 0)
+        if (!child)
         {
-            return -1;  // Sɖ
+            return;
         }
 
-        return getMSB(enableFLIBit);
-    }
-
-    inline size_t getBlockArrayIndex(const uint32_t FLI, const uint32_t SLI) const
-    {
-        return (FLI - kSplitNum) * (1 << kSplitNum) + SLI;
+        assert(child->mParent || !"not a child heap!");
+        TLSFAllocator* parent = child->mParent;
+        child->~TLSFAllocator();
+        parent->deallocate(child);
     }
 
-    inline void registerFLI(const uint32_t memorySize)
+    // x}[W[hݒ肷 (budgetoCg𒴂܂Ƃ߂ă}[W, 0Ŗ)
+    void setDeferredCoalescing(uint32_t budget)
     {
-        mAllFLI |= (1 << getMSB(memorySize));
+        mDeferredBudget = budget;
+        if (!mDeferredBudget)
+        {
+            flushDeferred();
+        }
     }
 
-    inline void unregisterFLI(const uint32_t memorySize)
+    // poTCY̐pXgg (1TCYblockNum܂ŉubN}[Wێ, 0Ŗ)
+    // mۂTCY̕px𐔂, kHotSizeNum̃TCY𓯂TCỸubNŒڂ肷
+    void setHotSizeCache(uint32_t blockNum)
     {
-        mAllFLI &= ~(1 << getMSB(memorySize));
+        mHotListLimit = blockNum;
+        if (!mHotListLimit)
+        {
+            for (uint32_t i = 0; i < mHotSizeNum; ++i)
+            {
+                drainHotList(mHotLists[i]);
+            }
+            mHotSizeNum = 0;
+        }
     }
 
-    inline void removeBlockFromList(BoundaryBlock<TLSFBlockHeader>* pBlock, BoundaryBlock<TLSFBlockHeader>* pRight = nullptr)
+    // xĂubNƕpoTCỸXg̃ubNׂă}[Wăt[Xg֖߂
+    void flushDeferred()
     {
-        // ̃ubNƓFLI, SLĨubN݂Ȃ
-        if (!pBlock->header.next && !pBlock->header.pre)
-        {
-            unregisterFLI(pBlock->getMemorySize());
-            const auto FLI = getMSB(pBlock->getMemorySize());
-            const auto SLI = getSecondLevel(pBlock->getMemorySize(), FLI, kSplitNum);
-            mBlockArray[getBlockArrayIndex(FLI, SLI)] = nullptr;
-        }
-        // ÕubN݂͑
-        else if (pBlock->header.pre)
+        for (uint32_t i = 0; i < mHotSizeNum; ++i)
         {
-            pBlock->header.pre->next = pBlock->header.next;
-            if (pBlock->header.next)
-            {
-                pBlock->header.next->pre = pBlock->header.pre;
-            }
+            drainHotList(mHotLists[i]);
         }
-        // ̃ubN̂ݑ݂
-        else if (pBlock->header.next)
+
+        for (size_t i = 0; i < mBlockArraySize && mDeferredSize; ++i)
         {
-            pBlock->header.next->pre = nullptr;
-            const auto FLI = getMSB(pBlock->getMemorySize());
-            const auto SLI = getSecondLevel(pBlock->getMemorySize(), FLI, kSplitNum);
-            if (pRight)
+            while (mDeferredArray[i])
             {
-                mBlockArray[getBlockArrayIndex(FLI, SLI)] = reinterpret_cast<BoundaryBlock<TLSFBlockHeader>*>(pRight->header.next);
-            }
-            else
-            {
-                mBlockArray[getBlockArrayIndex(FLI, SLI)] = reinterpret_cast<BoundaryBlock<TLSFBlockHeader>*>(pBlock->header.next);
+                auto* pBlock = mDeferredArray[i];
+                mDeferredArray[i] = reinterpret_cast<BoundaryBlock<TLSFBlockHeader>*>(pBlock->header.next);
+                pBlock->header.next = nullptr;
+                mDeferredSize -= pBlock->getMemorySize();
+
+                mergeAndRegister(pBlock);
             }
         }
-        else
-        {
-            assert(!"invalid");
-        }
     }
 
-
+    //ׂĉZbg
+    void clearAll()
+    {
+        for (size_t i = 0; i < mBlockArraySize; ++i)
+        {
+            mBlockArray[i] = nullptr;
+            mDeferredArray[i] = nullptr;
+        }
+        mDeferredSize = 0;
+        for (auto& list : mHotLists)
+        {
+            list.head = nullptr;
+            list.num = 0;
+        }
+        mHotCachedSize = 0;
+        for (auto& tag : mTags)
+        {
+            tag.usedSize = 0;
+        }
+        // nh\Ǘɂ̂ŏ
+        mHandleTable = nullptr;
+        mHandleCapacity = 0;
+        mHandleFreeList = kInvalidHandle;
+        mCompactPool = nullptr;
+        mCompactCursor = nullptr;
+        mControl->flBitmap = 0;
+        for (auto& bitmap : mControl->slBitmap)
+        {
+            bitmap = 0;
+        }
+
+        // ǉv[܂߂Ĕԕ̊Ԃ̃t[ubNɖ߂
+        // ̃t[ubN̂[̂܂܂̕͏݂̍ōB_ (high-water mark) Ȃ̂ňp
+        mWilderness = nullptr;
+        for (TLSFPoolInfo* info = mPoolList; info; info = info->next)
+        {
+            auto* last = getPoolTail(info)->prev();
+            std::byte* dirtyEnd = last->header.used ? reinterpret_cast<std::byte*>(getPoolTail(info)) : reinterpret_cast<std::byte*>(last->getMemory()) + getDirtySize(last);
+
+            auto* block = resetPool(info);
+            block->header.dirtySize = static_cast<uint32_t>(dirtyEnd - reinterpret_cast<std::byte*>(block->getMemory()));
+            registerFreeBlock(block);
+        }
+    }
+
+    // ubN擪HēvWv (ubNɔ)
+    TLSFStatistics getStatistics()
+    {
+        TLSFStatistics stats;
+        stats.deferredSize = mDeferredSize;
+        stats.hotCachedSize = mHotCachedSize;
+
+        for (TLSFPoolInfo* info = mPoolList; info; info = info->next)
+        {
+            // ԕubN͐Ȃ
+            auto* tail = getPoolTail(info);
+            uint64_t footprint = 0;
+            for (auto* block = getPoolHead(info)->next(); block != tail; block = block->next())
+            {
+                if (block->header.used)
+                {
+                    stats.usedSize += block->getMemorySize();
+                    ++stats.usedBlockNum;
+                    footprint = reinterpret_cast<std::byte*>(block->next()) - reinterpret_cast<std::byte*>(getPoolHead(info));
+                }
+                else
+                {
+                    stats.freeSize += block->getMemorySize();
+                    ++stats.freeBlockNum;
+                    if (block->getMemorySize() > stats.maxFreeSize)
+                    {
+                        stats.maxFreeSize = block->getMemorySize();
+                    }
+                }
+            }
+            stats.footprint += footprint;
+        }
+
+        return stats;
+    }
+
+    // t[ubN̊ǗgranularityEɑ͈͂؂ofunction(begin, size)ɓn, voCgԂ
+    // OSփԂƂp, q[Wy[WŊmۂv[Ȃgranularityq[Wy[W̃TCYɂΕfȂ
+    // xpoTCỸXg̃ubN͎gpȂ̂, ܂߂ΐflushDeferred()Ă
+    template <class Function>
+    uint64_t forEachFreeRange(uint32_t granularity, Function&& function)
+    {
+        assert((granularity & (granularity - 1)) == 0 || !"granularity must be power of 2!");
+
+        uint64_t rangeSize = 0;
+        for (TLSFPoolInfo* info = mPoolList; info; info = info->next)
+        {
+            auto* tail = getPoolTail(info);
+            for (auto* block = getPoolHead(info)->next(); block != tail; block = block->next())
+            {
+                if (block->header.used)
+                {
+                    continue;
+                }
+
+                // wb_ƏI[^O͎c
+                const auto memory = reinterpret_cast<uintptr_t>(block->getMemory());
+                const uintptr_t begin = (memory + granularity - 1) & ~static_cast<uintptr_t>(granularity - 1);
+                const uintptr_t end = (memory + block->getMemorySize()) & ~static_cast<uintptr_t>(granularity - 1);
+                if (begin < end)
+                {
+                    function(reinterpret_cast<std::byte*>(begin), static_cast<size_t>(end - begin));
+                    rangeSize += end - begin;
+                }
+            }
+        }
+
+        return rangeSize;
+    }
+
+    // ݂̊蓖ď󋵂dump
+    void dump()
+    {
+        const auto maxFLI = getMSB(mMaxSize);
+        const auto maxSLI = 1 << kSplitNum;
+
+        std::cerr << "----------------dump-----------------\n";
+        for (size_t fli = kSplitNum; fli <= maxFLI; ++fli)
+        {
+            for (size_t sli = 0; sli < maxSLI; ++sli)
+            {
+                std::cerr << (1ul << fli) + (1ul << fli) / (1ul << kSplitNum) * sli << "(" << fli << " , " << sli << ") : ";
+                auto* p = reinterpret_cast<std::byte*>(mBlockArray[getBlockArrayIndex(fli, sli)]);
+                if (!p)
+                {
+                    std::cerr << "null\n";
+                }
+                else if (p < mMemory || p >= mMemory + mAllSize)
+                {
+                    std::cerr << "invalid\n";
+                }
+                else
+                {
+                    std::cerr << "found\n";
+                }
+            }
+        }
+        std::cerr << "----------------end of dump-----------------\n";
+    }
+
+private:
+    // ^O̗\ZmFăubN蓖, ^O̎gpʂɉ
+    BoundaryBlock<TLSFBlockHeader>* allocateTaggedBlock(uint32_t size, uint8_t tag, uint32_t alignment = kAlignment, TLSFLifetimeHint hint = TLSFLifetimeHint::Unknown)
+    {
+        if (tag >= kTagNum)
+        {
+            assert(!"invalid tag!");
+            return nullptr;
+        }
+
+        auto& tagInfo = mTags[tag];
+
+        // \Z𒴂ȂTɒf (mێsnhĂ΂Ȃ)
+        if (tagInfo.budget && tagInfo.usedSize + size > tagInfo.budget)
+        {
+            return nullptr;
+        }
+
+        auto* block = alignment > kAlignment ? allocateAlignedBlock(size, alignment) : allocateBlock(size, hint);
+        if (!block)
+        {
+            return nullptr;
+        }
+
+        // ؂グ╪Ȃ[ŗ\Z𒴂߂
+        if (tagInfo.budget && tagInfo.usedSize + block->getMemorySize() > tagInfo.budget)
+        {
+            releaseBlock(block);
+            return nullptr;
+        }
+
+        block->header.tag = tag;
+        tagInfo.usedSize += block->getMemorySize();
+        return block;
+    }
+
+    // qq[v̊mێsnh: e`Nmۂăv[ɉ
+    static bool growFromParent(TLSFAllocator& child, uint32_t size, void*)
+    {
+        // ǉv[̃ubNTŌTCY (GoodFit͎̃TCYт֐؂グĒT) ɂ
+        // ŏ̗̈傫ȃubN͍Ȃ
+        constexpr uint64_t blockOverhead = kPoolOverhead + sizeof(BoundaryBlock<TLSFBlockHeader>) + sizeof(uint32_t);
+        const uint64_t needSize = (child.getFindableSize(size) + blockOverhead + kAlignment - 1) & ~static_cast<uint64_t>(kAlignment - 1);
+        const uint64_t maxSize = static_cast<uint64_t>(child.mMaxSize) + blockOverhead;
+        if (needSize > maxSize)
+        {
+            return false;
+        }
+
+        uint64_t chunkSize = child.mGrowSize > needSize ? child.mGrowSize : needSize;
+        chunkSize = chunkSize < maxSize ? chunkSize : maxSize;
+        if (chunkSize > child.mParent->mMaxSize)
+        {
+            return false;
+        }
+
+        std::byte* chunk = child.mParent->allocate(static_cast<uint32_t>(chunkSize), child.mParentTag);
+        if (!chunk)
+        {
+            return false;
+        }
+
+        // e̊ǗkAlignmentEɑĂ̂Ńv[擪̂܂܃`N擪ɂȂ
+        if (!child.addPool(chunk, static_cast<uint32_t>(chunkSize)))
+        {
+            child.mParent->deallocate(chunk);
+            return false;
+        }
+        return true;
+    }
+
+    // alignmentEɊǗubN蓖Ă
+    // ]ɊmۂċE̎Ot[ubNƂĐ؂o, ̗]߂
+    BoundaryBlock<TLSFBlockHeader>* allocateAlignedBlock(uint32_t size, uint32_t alignment)
+    {
+        // ؂ot[ubN̍ŏoCg (wb_, ŏ̊Ǘ, [^O)
+        constexpr uint32_t minGap = sizeof(BoundaryBlock<TLSFBlockHeader>) + (((kMinBlockSize + sizeof(uint32_t) + kAlignment - 1) & ~(kAlignment - 1)) - sizeof(uint32_t)) + sizeof(uint32_t);
+
+        // 蓖ĂubN̊ǗTCYɐɐ؂グĂ
+        // (؂oɎc镪菬ƍŏ̃TCYт)
+        if (size < kMinBlockSize)
+        {
+            size = kMinBlockSize;
+        }
+        // őTCY𒴂ȂallocateBlock()ƓقnullptrԂ
+        if (size > mMaxSize || (size = alignMemorySize(size)) > mMaxSize)
+        {
+            return nullptr;
+        }
+
+        const uint64_t searchSize = static_cast<uint64_t>(size) + alignment + minGap;
+        if (searchSize > mMaxSize)
+        {
+            return nullptr;
+        }
+
+        auto* block = allocateBlock(static_cast<uint32_t>(searchSize));
+        if (!block)
+        {
+            return nullptr;
+        }
+
+        auto* memory = reinterpret_cast<std::byte*>(block->getMemory());
+        if (alignPointer(memory, alignment) != memory)
+        {
+            // E̎OɃt[ubNʒu܂Ői߂
+            const uint32_t gap = static_cast<uint32_t>(alignPointer(memory + minGap, alignment) - memory);
+            const uint32_t dirtySize = block->header.dirtySize;
+
+            auto* aligned = block->split(gap - sizeof(uint32_t) - sizeof(BoundaryBlock<TLSFBlockHeader>));
+            aligned->header.used = true;
+            aligned->header.dirtySize = dirtySize > gap ? dirtySize - gap : 0;
+            mergeAndRegister(block);
+            block = aligned;
+        }
+
+        // ̗]ōŏubNȂ߂
+        if (block->enableSplit(size + kMinBlockSize))
+        {
+            auto* splitted = block->split(size);
+            splitted->header.used = true;
+            mergeAndRegister(splitted);
+        }
+
+        if (block->header.dirtySize > block->getMemorySize())
+        {
+            block->header.dirtySize = block->getMemorySize();
+        }
+
+        return block;
+    }
+
+    // nh\{ɍL (\̂Ǘmۂ, ړ͂Ȃ)
+    bool growHandleTable()
+    {
+        const uint32_t capacity = mHandleCapacity ? mHandleCapacity * 2 : 64;
+        auto* table = reinterpret_cast<HandleEntry*>(allocate(capacity * sizeof(HandleEntry)));
+        if (!table)
+        {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < mHandleCapacity; ++i)
+        {
+            table[i] = mHandleTable[i];
+        }
+        // 0Ԃ͖ȃnhȂ̂ŎgȂ
+        for (uint32_t i = mHandleCapacity ? mHandleCapacity : 1; i < capacity; ++i)
+        {
+            table[i] = { nullptr, 0, i + 1 < capacity ? i + 1 : mHandleFreeList };
+        }
+        mHandleFreeList = mHandleCapacity ? mHandleCapacity : 1;
+
+        if (mHandleTable)
+        {
+            deallocate(mHandleTable);
+        }
+        mHandleTable = table;
+        mHandleCapacity = capacity;
+        return true;
+    }
+
+    // compactStep()ňړĂ悢ubN
+    inline bool isMovable(BoundaryBlock<TLSFBlockHeader>* pBlock) const
+    {
+        return pBlock->header.used && pBlock->header.handle && !mHandleTable[pBlock->header.handle].pinCount;
+    }
+
+    // t[ubNfreeBlock̒ɂgp̃ubNO֋l, 󂢂t[ubNɂĕԂ
+    BoundaryBlock<TLSFBlockHeader>* moveBlockDown(BoundaryBlock<TLSFBlockHeader>* freeBlock, BoundaryBlock<TLSFBlockHeader>* pBlock)
+    {
+        // ړ͈ړ̃wb_ɏdȂ̂Őɓǂł
+        const uint32_t freeSize = freeBlock->getMemorySize();
+        const uint32_t size = pBlock->getMemorySize();
+        const uint8_t tag = pBlock->header.tag;
+        const Handle handle = pBlock->header.handle;
+        const bool isWilderness = freeBlock == mWilderness;
+        if (isWilderness)
+        {
+            mWilderness = nullptr;
+        }
+        else
+        {
+            removeBlockFromList(freeBlock);
+        }
+
+        std::memmove(reinterpret_cast<std::byte*>(freeBlock) + sizeof(BoundaryBlock<TLSFBlockHeader>), pBlock->getMemory(), size);
+
+        auto* moved = new (freeBlock) BoundaryBlock<TLSFBlockHeader>(size);
+        moved->header.used = true;
+        moved->header.tag = tag;
+        moved->header.handle = handle;
+        mHandleTable[handle].block = moved;
+
+        // ̋󂫂͉Eׂ󂢂Ă΃}[W
+        auto* rest = new (moved->next()) BoundaryBlock<TLSFBlockHeader>(freeSize);
+        mergeAndRegister(rest, isWilderness);
+        return rest;
+    }
+
+    // gp̃ubN
+    void releaseBlock(BoundaryBlock<TLSFBlockHeader>* pBlock)
+    {
+        // poTCYȂ}[WpXgɐς
+        if (mHotListLimit && pushHotBlock(pBlock))
+        {
+            return;
+        }
+
+        // x[hł͎gp̂܂܃Xgɐς, \Z𒴂܂Ƃ߂ă}[W
+        if (mDeferredBudget)
+        {
+            pushDeferredBlock(pBlock);
+            if (mDeferredSize > mDeferredBudget)
+            {
+                flushDeferred();
+            }
+
+            return;
+        }
+
+        mergeAndRegister(pBlock);
+    }
+
+    // ubN蓖Ă
+    // ԂubNdirtySizeɂ͊Ǘ̂NAKvȃoCg
+    BoundaryBlock<TLSFBlockHeader>* allocateBlock(uint32_t size, TLSFLifetimeHint hint = TLSFLifetimeHint::Unknown)
+    {
+        if (size < 0)
+        {
+            assert(!"invalid allocation size!");
+            return nullptr;
+        }
+        if (size < kMinBlockSize)
+        {
+            // ŏubNTCYɐ؂グ
+            size = kMinBlockSize;
+        }
+
+        // őTCY𒴂v͋󂫂ƂƓقnullptrԂ
+        // (TLSFFallbackAllocatorȂǂő̃AP[^։񂹂悤)
+        if (size > mMaxSize || (size = alignMemorySize(size)) > mMaxSize)
+        {
+            return nullptr;
+        }
+
+        // poTCY͓TCỸubN̂܂܍ėp
+        // ̃ubN͂ǂɂ邩Ȃg񂵂̃ubNgȂ
+        if (mHotListLimit && hint != TLSFLifetimeHint::Long)
+        {
+            if (auto* hot = popHotBlock(size))
+            {
+                return hot;
+            }
+        }
+
+        // xꂽubN΃}[Ŵ܂܍ėp
+        if (mDeferredSize && hint != TLSFLifetimeHint::Long)
+        {
+            if (auto* deferred = popDeferredBlock(size))
+            {
+                return deferred;
+            }
+        }
+
+        BoundaryBlock<TLSFBlockHeader>* target = searchFreeBlock(size);
+
+        // ȂΊmێsnhɌĂ, 󂢂Ďs
+        // 󂯂ƌĂȂnhĂёȂ悤, Ďs̉񐔂͐
+        for (uint32_t i = 0, retryNum = 0; !target && i < mFailureHandlerNum;)
+        {
+            if (retryNum < kFailureRetryNum && mFailureHandlers[i].handler(*this, size, mFailureHandlers[i].userData))
+            {
+                target = searchFreeBlock(size);
+                ++retryNum;
+            }
+            else
+            {
+                ++i;
+                retryNum = 0;
+            }
+        }
+
+        if (!target)  // SȂ
+        {
+            return nullptr;
+        }
+
+        // wilderness̓XgɓĂȂ̂, ؂ocVwildernessɂ邾ł悢
+        const bool isWilderness = target == mWilderness;
+        if (isWilderness)
+        {
+            mWilderness = nullptr;
+        }
+        else
+        {
+            removeBlockFromList(target);
+        }
+        const uint32_t dirtySize = getDirtySize(target);
+
+        // ]ōŏubNȂ番, ̂t[Xg֖߂
+        if (target->enableSplit(size + kMinBlockSize) && hint == TLSFLifetimeHint::Short)
+        {
+            // Z͌납؂o, O̎ct[̂܂܂ɂ
+            const uint32_t restSize = target->getMemorySize() - size - sizeof(uint32_t) - sizeof(BoundaryBlock<TLSFBlockHeader>);
+            auto* allocated = target->split(restSize);
+            const uint32_t offset = restSize + sizeof(uint32_t) + sizeof(BoundaryBlock<TLSFBlockHeader>);
+            allocated->header.dirtySize = dirtySize > offset ? dirtySize - offset : 0;
+            target->header.dirtySize = dirtySize < restSize ? dirtySize : restSize;
+            if (isWilderness)
+            {
+                mWilderness = target;
+            }
+            else
+            {
+                insertBlockToList(target);
+            }
+            target = allocated;
+        }
+        else if (target->enableSplit(size + kMinBlockSize))
+        {
+            auto* splitted = target->split(size);
+            // c̊Ǘ͊mۂƌ[^O, wb_̌납n܂
+            const uint32_t offset = size + sizeof(uint32_t) + sizeof(BoundaryBlock<TLSFBlockHeader>);
+            splitted->header.dirtySize = dirtySize > offset ? dirtySize - offset : 0;
+            if (isWilderness)
+            {
+                mWilderness = splitted;
+            }
+            else
+            {
+                insertBlockToList(splitted);
+            }
+        }
+
+        target->header.dirtySize = getDirtySize(target);
+        target->header.used = true;
+        return target;
+    }
+
+    inline uint32_t getMSB(uint32_t data) const
+    {
+        if (data == 0)
+        {
+            return 0;
+        }
+
+        uint32_t index = 0;
+        for (; data != 1; ++index)
+        {
+            data = data >> 1;
+        }
+
+        return index;
+    }
+
+    template <typename T>
+    inline uint32_t getLSB(T data) const
+    {
+        uint32_t index = 0;
+        for (; data % 2 == 0; ++index)
+        {
+            data = data >> 1;
+        }
+
+        return index;
+    }
+
+    inline uint32_t getSecondLevel(uint32_t size, uint32_t MSB, uint32_t N) const
+    {
+        // ŏʃrbg̃rbg񂾂Lɂ}XN
+        const uint32_t mask = (1 << MSB) - 1;  // 1000 0000 -> 0111 1111
+
+        // Eւ̃VtgZo
+        const uint32_t rs = MSB - N;  // 7 - 3 = 4 i8ȂN=3j
+
+        // sizeɃ}XNāAEփVtg΃CfbNX
+        return (size & mask) >> rs;
+    }
+
+    inline uint32_t getFreeListSLI(uint32_t mySLI, typename TLSFControlBlock<kSplitNum>::SLBitmap freeListBit)
+    {
+        using SLBitmap = typename TLSFControlBlock<kSplitNum>::SLBitmap;
+
+        // SLIȏオĂrbg쐬 (ID = 0ȂSrbgj
+        SLBitmap myBit = static_cast<SLBitmap>(~uint64_t(0) << mySLI);
+
+        // myBitfreeListBit_ς΁Amۉ\ȃubNSLI
+        SLBitmap enableListBit = freeListBit & myBit;
+
+        // LSB߂Ίmۉ\ȈԃTCY̏t[XgubN̔
+        if (enableListBit == 0)
+        {
+            return -1;  // t[Xg
+        }
+
+        return getLSB(enableListBit);
+    }
+
+    inline uint32_t getFreeListFLI(uint32_t myFLI, uint32_t globalFLI)
+    {
+        uint32_t myBit = 0xffffffff << myFLI;
+        uint32_t enableFLIBit = globalFLI & myBit;
+        if (enableFLIBit == 0)
+        {
+            return -1;  // Sɖ
+        }
+
+        // mۉ\ȈԏFLIԂ
+        return getLSB(enableFLIBit);
+    }
+
+    // wFLÎt[ubNSLĨrbg擾
+    inline typename TLSFControlBlock<kSplitNum>::SLBitmap getFreeListBit(const uint32_t FLI) const
+    {
+        return mControl->slBitmap[FLI - kSplitNum];
+    }
+
+    // findFreeBlock()size̗vŕKubN̍ŏ̊ǗTCY
+    inline uint64_t getFindableSize(const uint32_t size) const
+    {
+        if constexpr (FitPolicy::kSearchExactClass)
+        {
+            return size;
+        }
+        else
+        {
+            // findFreeBlock()Ɠ̃TCYт̐擪֐؂グ
+            const uint64_t roundedSize = static_cast<uint64_t>(size) + (1ull << (getMSB(size) - kSplitNum)) - 1;
+            if (roundedSize > 0xffffffff)
+            {
+                return roundedSize;
+            }
+
+            return roundedSize & ~((1ull << (getMSB(static_cast<uint32_t>(roundedSize)) - kSplitNum)) - 1);
+        }
+    }
+
+    // vTCY𖞂t[ubN (nullptr)
+    BoundaryBlock<TLSFBlockHeader>* findFreeBlock(const uint32_t size)
+    {
+        uint32_t FLI = getMSB(size);
+        uint32_t SLI = getSecondLevel(size, FLI, kSplitNum);
+
+        if constexpr (FitPolicy::kSearchExactClass)
+        {
+            // TCYт̃Xg̓TCYȂubN܂ނ̂ŒHĒT
+            for (auto* header = reinterpret_cast<TLSFBlockHeader*>(mBlockArray[getBlockArrayIndex(FLI, SLI)]); header; header = header->next)
+            {
+                if (header->getSize() >= size)
+                {
+                    return reinterpret_cast<BoundaryBlock<TLSFBlockHeader>*>(header);
+                }
+            }
+
+            // ̃TCYт͕KvTCYȏ
+            if (++SLI == (1ul << kSplitNum))
+            {
+                SLI = 0;
+                ++FLI;
+            }
+        }
+        else
+        {
+            // ̃TCYт̐擪֐؂グ (E傤ǂȂ炻̂܂)
+            const uint64_t roundedSize = static_cast<uint64_t>(size) + (1ull << (FLI - kSplitNum)) - 1;
+            if (roundedSize > 0xffffffff)
+            {
+                return nullptr;
+            }
+
+            FLI = getMSB(static_cast<uint32_t>(roundedSize));
+            SLI = getSecondLevel(static_cast<uint32_t>(roundedSize), FLI, kSplitNum);
+        }
+
+        if (getBlockArrayIndex(FLI, SLI) >= mBlockArraySize)
+        {
+            return nullptr;
+        }
+
+        // FLI̒ŋ󂢂ĂSLIT
+        const uint32_t newSLI = getFreeListSLI(SLI, getFreeListBit(FLI));
+        if (newSLI != -1)
+        {
+            return mBlockArray[getBlockArrayIndex(FLI, newSLI)];
+        }
+
+        // second levelɂ͂Ȃ̂ŏFLIT
+        if (FLI + 1 >= 32)
+        {
+            return nullptr;
+        }
+
+        const uint32_t newFLI = getFreeListFLI(FLI + 1, mControl->flBitmap);
+        if (newFLI == -1)
+        {
+            return nullptr;
+        }
+
+        return mBlockArray[getBlockArrayIndex(newFLI, getLSB(getFreeListBit(newFLI)))];
+    }
+
+    // t[XgɍubNwildernessg, ȂΒx̃ubN}[WĂT
+    inline BoundaryBlock<TLSFBlockHeader>* searchFreeBlock(const uint32_t size)
+    {
+        BoundaryBlock<TLSFBlockHeader>* target = findFreeBlock(size);
+        if (!target && mWilderness && mWilderness->getMemorySize() >= size)
+        {
+            return mWilderness;
+        }
+
+        if (!target && (mDeferredSize || mHotCachedSize))  // xĂ}[W܂Ƃ߂čsČ
+        {
+            flushDeferred();
+            target = findFreeBlock(size);
+            if (!target && mWilderness && mWilderness->getMemorySize() >= size)
+            {
+                return mWilderness;
+            }
+        }
+
+        return target;
+    }
+
+    struct SizeCounter
+    {
+        uint32_t size;
+        uint32_t count;
+    };
+    struct HotList
+    {
+        uint32_t size;
+        uint32_t num;
+        BoundaryBlock<TLSFBlockHeader>* head;  // gp̂܂܂̃ubNheader.nextłȂ
+    };
+
+    // mۃTCY̕px𐔂, poTCYȂ炻̃Xgo
+    inline BoundaryBlock<TLSFBlockHeader>* popHotBlock(const uint32_t size)
+    {
+        // Փ˂猸炵, 0ɂȂւ (oPbgƂMisra-Gries)
+        auto& counter = mSizeCounters[((size >> 4) * 2654435761u) >> (32 - 6)];
+        static_assert(kSizeCounterNum == 64, "counter index uses 6 bits");
+        if (counter.size == size)
+        {
+            ++counter.count;
+        }
+        else if (counter.count)
+        {
+            --counter.count;
+        }
+        else
+        {
+            counter = { size, 1 };
+        }
+
+        if (++mHotEpochCount >= kHotSizeEpoch)
+        {
+            updateHotSizes();
+        }
+
+        for (uint32_t i = 0; i < mHotSizeNum; ++i)
+        {
+            auto& list = mHotLists[i];
+            if (list.size == size)
+            {
+                auto* pBlock = list.head;
+                if (!pBlock)
+                {
+                    return nullptr;
+                }
+
+                list.head = reinterpret_cast<BoundaryBlock<TLSFBlockHeader>*>(pBlock->header.next);
+                --list.num;
+                pBlock->header.next = nullptr;
+                pBlock->header.dirtySize = pBlock->getMemorySize();
+                mHotCachedSize -= pBlock->getMemorySize();
+                return pBlock;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // poTCYƂ傤ǓTCỸubNȂgp̂܂܃Xgɐς
+    inline bool pushHotBlock(BoundaryBlock<TLSFBlockHeader>* pBlock)
+    {
+        for (uint32_t i = 0; i < mHotSizeNum; ++i)
+        {
+            auto& list = mHotLists[i];
+            if (list.size == pBlock->getMemorySize())
+            {
+                if (list.num >= mHotListLimit)
+                {
+                    return false;
+                }
+
+                pBlock->header.next = list.head ? &list.head->header : nullptr;
+                list.head = pBlock;
+                ++list.num;
+                mHotCachedSize += pBlock->getMemorySize();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // JE^̏ʂpoTCYɑIђ, OꂽTCỸXg̓}[WĖ߂
+    void updateHotSizes()
+    {
+        mHotEpochCount = 0;
+
+        // 1G|bN1/64ȂTCY͑I΂Ȃ
+        SizeCounter top[kHotSizeNum] = {};
+        for (auto& counter : mSizeCounters)
+        {
+            SizeCounter candidate = counter;
+            if (candidate.count < kHotSizeEpoch / 64)
+            {
+                continue;
+            }
+
+            for (auto& t : top)
+            {
+                if (candidate.count > t.count)
+                {
+                    std::swap(candidate, t);
+                }
+            }
+        }
+
+        // I΂ꑱTCỸXg͎c
+        HotList lists[kHotSizeNum] = {};
+        uint32_t listNum = 0;
+        for (auto& t : top)
+        {
+            if (!t.count)
+            {
+                continue;
+            }
+
+            lists[listNum] = { t.size, 0, nullptr };
+            for (uint32_t i = 0; i < mHotSizeNum; ++i)
+            {
+                if (mHotLists[i].size == t.size)
+                {
+                    lists[listNum] = mHotLists[i];
+                    mHotLists[i].head = nullptr;
+                    mHotLists[i].num = 0;
+                }
+            }
+            ++listNum;
+        }
+
+        for (uint32_t i = 0; i < mHotSizeNum; ++i)
+        {
+            drainHotList(mHotLists[i]);
+        }
+        for (uint32_t i = 0; i < kHotSizeNum; ++i)
+        {
+            mHotLists[i] = lists[i];
+        }
+        mHotSizeNum = listNum;
+
+        // Âpx͔Ɍ炵Ă
+        for (auto& counter : mSizeCounters)
+        {
+            counter.count /= 2;
+        }
+    }
+
+    // poTCỸXg̃ubN}[Wăt[Xg֖߂
+    void drainHotList(HotList& list)
+    {
+        while (list.head)
+        {
+            auto* pBlock = list.head;
+            list.head = reinterpret_cast<BoundaryBlock<TLSFBlockHeader>*>(pBlock->header.next);
+            pBlock->header.next = nullptr;
+            mHotCachedSize -= pBlock->getMemorySize();
+
+            mergeAndRegister(pBlock);
+        }
+        list.num = 0;
+    }
+
+    // ׂ̃t[ubNƃ}[Wăt[Xg֓o^
+    // wildernessƃ}[WƂ (toWildernessȂ炢ł) ̓}[WubNwildernessɂ
+    void mergeAndRegister(BoundaryBlock<TLSFBlockHeader>* pBlock, bool toWilderness = false)
+    {
+        pBlock->header.used = false;
+        // gĂubN͑Ŝ܂ꂽƂ݂Ȃ
+        pBlock->header.dirtySize = pBlock->getMemorySize();
+
+        // ׂgpĂmergeȂ (v[̗[͎gp̔ԕubN)
+        const bool isRightFree = !(pBlock->next()->header.used);
+        const bool isLeftFree = !(pBlock->prev()->header.used);
+
+        // Ԃɂ[^Oƃwb_̊̕Ǘ𒴂ĉ
+        constexpr uint32_t kJointSize = sizeof(uint32_t) + sizeof(BoundaryBlock<TLSFBlockHeader>);
+
+        if (isRightFree)  // E󂢂Ă̂Ń}[W
+        {
+            auto* right = pBlock->next();
+            const uint32_t dirtySize = pBlock->getMemorySize() + kJointSize + getDirtySize(right);
+            if (right == mWilderness)  // wildernessɖ߂
+            {
+                mWilderness = nullptr;
+                toWilderness = true;
+            }
+            else
+            {
+                removeBlockFromList(right);
+            }
+            if (right == mCompactCursor)
+            {
+                mCompactCursor = pBlock;
+            }
+
+            pBlock->merge();
+            pBlock->header.dirtySize = dirtySize;
+        }
+
+        // ̃ubN}[W
+        if (isLeftFree)
+        {
+            // ubNXgOē
+            const uint32_t rightDirtySize = pBlock->header.dirtySize;
+            if (pBlock == mCompactCursor)
+            {
+                mCompactCursor = pBlock->prev();
+            }
+            pBlock = pBlock->prev();
+            if (pBlock == mWilderness)  // Z̃ubNwildernesšɂ
+            {
+                mWilderness = nullptr;
+                toWilderness = true;
+            }
+            else
+            {
+                removeBlockFromList(pBlock);
+            }
+
+            const uint32_t dirtySize = pBlock->getMemorySize() + kJointSize + rightDirtySize;
+            pBlock->merge();
+            pBlock->header.dirtySize = dirtySize;
+        }
+
+        if (toWilderness)
+        {
+            setWilderness(pBlock);
+            return;
+        }
+        registerFreeBlock(pBlock);
+    }
+
+    // xXgsizeȏ̃ubNo (擪)
+    inline BoundaryBlock<TLSFBlockHeader>* popDeferredBlock(const uint32_t size)
+    {
+        const uint32_t FLI = getMSB(size);
+        const uint32_t SLI = getSecondLevel(size, FLI, kSplitNum);
+        auto*& head = mDeferredArray[getBlockArrayIndex(FLI, SLI)];
+
+        if (!head || head->getMemorySize() < size)
+        {
+            return nullptr;
+        }
+
+        auto* pBlock = head;
+        head = reinterpret_cast<BoundaryBlock<TLSFBlockHeader>*>(pBlock->header.next);
+        pBlock->header.next = nullptr;
+        pBlock->header.dirtySize = pBlock->getMemorySize();
+        mDeferredSize -= pBlock->getMemorySize();
+
+        return pBlock;
+    }
+
+    // gp̂܂ܒxXg֐ς
+    inline void pushDeferredBlock(BoundaryBlock<TLSFBlockHeader>* pBlock)
+    {
+        const uint32_t FLI = getMSB(pBlock->getMemorySize());
+        const uint32_t SLI = getSecondLevel(pBlock->getMemorySize(), FLI, kSplitNum);
+        auto*& head = mDeferredArray[getBlockArrayIndex(FLI, SLI)];
+
+        pBlock->header.next = head ? &head->header : nullptr;
+        head = pBlock;
+        mDeferredSize += pBlock->getMemorySize();
+    }
+
+    inline size_t getBlockArrayIndex(const uint32_t FLI, const uint32_t SLI) const
+    {
+        return (FLI - kSplitNum) * (1 << kSplitNum) + SLI;
+    }
+
+    // v[̑OɎgp̔ԕubNu, 擪̔ԕɃv[
+    TLSFPoolInfo* initPool(std::byte* memory, const uint32_t byteSize)
+    {
+        auto* head = new (memory) BoundaryBlock<TLSFBlockHeader>(kPoolHeadMemorySize);
+        head->header.used = true;
+
+        auto* tail = new (memory + byteSize - (sizeof(BoundaryBlock<TLSFBlockHeader>) + kPoolTailMemorySize + sizeof(uint32_t))) BoundaryBlock<TLSFBlockHeader>(kPoolTailMemorySize);
+        tail->header.used = true;
+
+        return new (head->getMemory()) TLSFPoolInfo{ nullptr, byteSize };
+    }
+
+    // v[̔ԕ̊Ԃ̃ubNɂ (Xgɂ͓o^Ȃ)
+    BoundaryBlock<TLSFBlockHeader>* resetPool(TLSFPoolInfo* info)
+    {
+        const uint32_t memorySize = info->size - kPoolOverhead - sizeof(BoundaryBlock<TLSFBlockHeader>) - sizeof(uint32_t);
+        return new (getPoolHead(info)->next()) BoundaryBlock<TLSFBlockHeader>(memorySize);
+    }
+
+    inline BoundaryBlock<TLSFBlockHeader>* getPoolHead(TLSFPoolInfo* info) const
+    {
+        return reinterpret_cast<BoundaryBlock<TLSFBlockHeader>*>(reinterpret_cast<std::byte*>(info) - sizeof(BoundaryBlock<TLSFBlockHeader>));
+    }
+
+    inline BoundaryBlock<TLSFBlockHeader>* getPoolTail(TLSFPoolInfo* info) const
+    {
+        return reinterpret_cast<BoundaryBlock<TLSFBlockHeader>*>(reinterpret_cast<std::byte*>(getPoolHead(info)) + info->size - (sizeof(BoundaryBlock<TLSFBlockHeader>) + kPoolTailMemorySize + sizeof(uint32_t)));
+    }
+
+    // t[ubN̊Ǘ̂Ă\oCg
+    inline uint32_t getDirtySize(BoundaryBlock<TLSFBlockHeader>* pBlock) const
+    {
+        return pBlock->header.dirtySize < pBlock->getMemorySize() ? pBlock->header.dirtySize : pBlock->getMemorySize();
+    }
+
+    // [NA (傫̈̓LbVoRȂXgAŏ)
+    static void clearMemory(std::byte* memory, uint32_t size)
+    {
+#if defined(__SSE2__) || defined(_M_X64)
+        if (size >= kStreamClearSize)
+        {
+            // ǗkAlignmentEɑĂ
+            const __m128i zero = _mm_setzero_si128();
+            const uint32_t streamSize = size & ~(sizeof(__m128i) * 4 - 1);
+            for (uint32_t i = 0; i < streamSize; i += sizeof(__m128i) * 4)
+            {
+                _mm_stream_si128(reinterpret_cast<__m128i*>(memory + i), zero);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(memory + i + 16), zero);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(memory + i + 32), zero);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(memory + i + 48), zero);
+            }
+            _mm_sfence();
+            std::memset(memory + streamSize, 0, size - streamSize);
+            return;
+        }
+#endif
+        std::memset(memory, 0, size);
+    }
+
+    // ǗŜ̃TCYKvȃXg擪̐߂
+    inline uint32_t getBlockArraySize(const uint32_t byteSize) const
+    {
+        return (getMSB(byteSize - sizeof(TLSFBlockHeader) - sizeof(uint32_t)) - kSplitNum + 1) * (1ul << kSplitNum);
+    }
+
+    // |C^alignE֐؂グ
+    inline std::byte* alignPointer(std::byte* p, const uintptr_t align) const
+    {
+        return reinterpret_cast<std::byte*>((reinterpret_cast<uintptr_t>(p) + align - 1) & ~(align - 1));
+    }
+
+    // ̃ubN̐擪kAlignmentEɑ悤ɊǗTCY؂グ
+    inline uint32_t alignMemorySize(const uint32_t size) const
+    {
+        return ((size + sizeof(uint32_t) + kAlignment - 1) & ~(kAlignment - 1)) - sizeof(uint32_t);
+    }
+
+    // ubNLbVCEɑĒuʒu
+    inline std::byte* alignControl(std::byte* mainMemory) const
+    {
+        return alignPointer(mainMemory, alignof(TLSFControlBlock<kSplitNum>));
+    }
+
+    // ubNv[ɒuƂ̃ubN̈̐擪
+    inline std::byte* getPoolMemory(std::byte* mainMemory, const uint32_t byteSize) const
+    {
+        std::byte* memory = alignControl(mainMemory) + TLSFControlBlock<kSplitNum>::getAllSize(getBlockArraySize(byteSize));
+        assert(memory < mainMemory + byteSize || !"memory is too small to place control block!");
+        return memory;
+    }
+
+    // rbg}bvɃt[ubN݂̑o^
+    inline void registerFreeList(const uint32_t FLI, const uint32_t SLI)
+    {
+        using SLBitmap = typename TLSFControlBlock<kSplitNum>::SLBitmap;
+
+        mControl->slBitmap[FLI - kSplitNum] |= static_cast<SLBitmap>(SLBitmap(1) << SLI);
+        mControl->flBitmap |= (1u << FLI);
+    }
+
+    inline void unregisterFreeList(const uint32_t FLI, const uint32_t SLI)
+    {
+        using SLBitmap = typename TLSFControlBlock<kSplitNum>::SLBitmap;
+
+        mControl->slBitmap[FLI - kSplitNum] &= static_cast<SLBitmap>(~(SLBitmap(1) << SLI));
+        // FLIɑ̃t[ubNcĂFLI͏Ȃ
+        if (!mControl->slBitmap[FLI - kSplitNum])
+        {
+            mControl->flBitmap &= ~(1u << FLI);
+        }
+    }
+
+    // t[ubNo^
+    // C̊Ǘ̖ɐڂubNwildernessƂăXgɓꂸ, mێɐ؂o
+    // Z̃ubNwildernesš납؂oĂ, wilderness͖痣Ă邱Ƃ
+    inline void registerFreeBlock(BoundaryBlock<TLSFBlockHeader>* pBlock)
+    {
+        if (pBlock->next() == mWildernessEnd && !mWilderness)
+        {
+            setWilderness(pBlock);
+            return;
+        }
+
+        insertBlockToList(pBlock);
+    }
+
+    inline void setWilderness(BoundaryBlock<TLSFBlockHeader>* pBlock)
+    {
+        pBlock->header.used = false;
+        pBlock->header.pre = nullptr;
+        pBlock->header.next = nullptr;
+        mWilderness = pBlock;
+    }
+
+    // t[Xg̐擪֓o^
+    inline void insertBlockToList(BoundaryBlock<TLSFBlockHeader>* pBlock)
+    {
+        const auto FLI = getMSB(pBlock->getMemorySize());
+        const auto SLI = getSecondLevel(pBlock->getMemorySize(), FLI, kSplitNum);
+        auto*& head = mBlockArray[getBlockArrayIndex(FLI, SLI)];
+
+        pBlock->header.used = false;
+        pBlock->header.pre = nullptr;
+        pBlock->header.next = head ? &head->header : nullptr;
+        if (head)
+        {
+            head->header.pre = &pBlock->header;
+        }
+        head = pBlock;
+
+        registerFreeList(FLI, SLI);
+    }
+
+    // t[XgO
+    inline void removeBlockFromList(BoundaryBlock<TLSFBlockHeader>* pBlock)
+    {
+        const auto FLI = getMSB(pBlock->getMemorySize());
+        const auto SLI = getSecondLevel(pBlock->getMemorySize(), FLI, kSplitNum);
+
+        // ÕubN݂͑
+        if (pBlock->header.pre)
+        {
+            pBlock->header.pre->next = pBlock->header.next;
+        }
+        // 擪̂Ŏ̃ubN擪ɂ
+        else
+        {
+            assert(mBlockArray[getBlockArrayIndex(FLI, SLI)] == pBlock || !"invalid");
+            mBlockArray[getBlockArrayIndex(FLI, SLI)] = reinterpret_cast<BoundaryBlock<TLSFBlockHeader>*>(pBlock->header.next);
+        }
+
+        if (pBlock->header.next)
+        {
+            pBlock->header.next->pre = pBlock->header.pre;
+        }
+
+        pBlock->header.pre = nullptr;
+        pBlock->header.next = nullptr;
+
+        // ̃ubNƓFLI, SLĨubN݂ȂȂ
+        if (!mBlockArray[getBlockArrayIndex(FLI, SLI)])
+        {
+            unregisterFreeList(FLI, SLI);
+        }
+    }
+
+
 // oϐ
-    BoundaryBlock<TLSFBlockHeader>** mBlockArray;
+    TLSFControlBlock<kSplitNum>* mControl;
+    BoundaryBlock<TLSFBlockHeader>** mBlockArray;     // mControl̃t[Xg擪
+    BoundaryBlock<TLSFBlockHeader>** mDeferredArray;  // mControl̒xXg擪 (gp̂܂ܕێ)
     std::byte* mMemory;
     const uint32_t mMaxSize;
     const uint32_t mAllSize;  //ubN܂߂Ŝ̑傫w
     const uint32_t mBlockArraySize;
-    uint32_t mAllFLI;
+    const bool mControlInPool;
+    TLSFPoolInfo* mPoolList;  // ŏ̊Ǘƒǉv[̃Xg
+    uint32_t mDeferredBudget;  // xoCg (0Ȃ瑦}[W)
+    uint32_t mDeferredSize;    // xXgɐς܂ĂoCg
+    BoundaryBlock<TLSFBlockHeader>* mWilderness;     // C̊Ǘ̖gp̈ (t[Xgɂ͓Ȃ, ɒZ̃ubN邱Ƃ)
+    BoundaryBlock<TLSFBlockHeader>* mWildernessEnd;  // C̊Ǘ̖̔ԕ
+
+    uint32_t mHotListLimit;   // 1TCYɕێubN (0Ȃ疳)
+    uint32_t mHotSizeNum;     // I΂ĂpoTCY̐
+    uint32_t mHotEpochCount;
+    uint32_t mHotCachedSize;  // poTCỸXgɐς܂ĂoCg
+    SizeCounter mSizeCounters[kSizeCounterNum];
+    HotList mHotLists[kHotSizeNum];
+
+    struct FailureHandlerEntry
+    {
+        FailureHandler handler;
+        void* userData;
+    };
+    FailureHandlerEntry mFailureHandlers[kFailureHandlerNum];
+    uint32_t mFailureHandlerNum;
+
+    struct TagInfo
+    {
+        uint64_t usedSize;  // gp̊ǗTCY
+        uint64_t budget;    // 0Ȃ疳
+    };
+    TagInfo mTags[kTagNum];
+
+    struct HandleEntry
+    {
+        BoundaryBlock<TLSFBlockHeader>* block;  // nullptrȂ疢gp
+        uint32_t pinCount;
+        Handle nextFree;  // gp̃nh̃Xg
+    };
+    HandleEntry* mHandleTable;  // nh\ (Ǘm)
+    uint32_t mHandleCapacity;
+    Handle mHandleFreeList;
+
+    TLSFPoolInfo* mCompactPool;  // compactStep()ŒHĂv[
+    BoundaryBlock<TLSFBlockHeader>* mCompactCursor;  // ɒׂubN (}[Wŏ瓝֕tւ)
+    bool mCompactMoved;  // ̎ňړ
+
+    TLSFAllocator* mParent;  // qq[vȂ̈mۂe
+    uint8_t mParentTag;      // emۂƂ̃^O
+    uint32_t mGrowSize;      // eǉ`ÑoCg
 };
 
 #endif
\ No newline at end of file
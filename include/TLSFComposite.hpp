@@ -0,0 +1,112 @@
+﻿#ifndef _HEADER_ONLY_TLSFCOMPOSITE_HPP_
+#define _HEADER_ONLY_TLSFCOMPOSITE_HPP_
+
+// TLSFAllocatorを他のアロケータと組み合わせるためのポリシー
+// 部品は次のメンバを持つ型ならなんでもよい (TLSFAllocatorはそのまま使える)
+//   std::byte* allocate(uint32_t size)      確保できなければnullptr (扱えない大きさの要求でもassertしない)
+//   bool deallocate(void* address)
+//   bool owns(const void* address) const    自分が確保したアドレスか
+// 仮想関数は使わないので組み合わせてもすべてインライン展開できる
+// 部品を別の場所で作って参照で持たせるときはテンプレート引数を参照型にする
+//
+//   TLSFAllocator<3> small(smallMemory, smallSize);
+//   TLSFAllocator<> large(largeMemory, largeSize);
+//   TLSFAllocator<> overflow(overflowMemory, overflowSize);
+//   using Large = TLSFFallbackAllocator<TLSFAllocator<>&, TLSFAllocator<>&>;
+//   TLSFSegregator<256, TLSFAllocator<3>&, Large> heap(small, Large(large, overflow));
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+
+// kThreshold以下の要求をSmall, それより大きい要求をLargeから確保する
+template <uint32_t kThreshold, class Small, class Large>
+class TLSFSegregator
+{
+public:
+    template <class SmallArg, class LargeArg>
+    TLSFSegregator(SmallArg&& smallAllocator, LargeArg&& largeAllocator)
+        : mSmall(std::forward<SmallArg>(smallAllocator))
+        , mLarge(std::forward<LargeArg>(largeAllocator))
+    {
+    }
+
+    // 部品を値で持つときに構築引数をタプルで渡す
+    template <class... SmallArgs, class... LargeArgs>
+    TLSFSegregator(std::piecewise_construct_t, std::tuple<SmallArgs...> smallArgs, std::tuple<LargeArgs...> largeArgs)
+        : mSmall(std::make_from_tuple<Small>(std::move(smallArgs)))
+        , mLarge(std::make_from_tuple<Large>(std::move(largeArgs)))
+    {
+    }
+
+    std::byte* allocate(uint32_t size)
+    {
+        return size <= kThreshold ? mSmall.allocate(size) : mLarge.allocate(size);
+    }
+
+    // 解放時はサイズが分からないのでowns()で振り分ける
+    bool deallocate(void* address)
+    {
+        return mSmall.owns(address) ? mSmall.deallocate(address) : mLarge.deallocate(address);
+    }
+
+    bool owns(const void* address) const
+    {
+        return mSmall.owns(address) || mLarge.owns(address);
+    }
+
+    Small& getSmall() { return mSmall; }
+    Large& getLarge() { return mLarge; }
+
+private:
+    Small mSmall;
+    Large mLarge;
+};
+
+// Primaryで確保できなければSecondaryから確保する
+// PrimaryがTLSFAllocatorなら失敗ハンドラを呼び終えてからSecondaryに回る
+template <class Primary, class Secondary>
+class TLSFFallbackAllocator
+{
+public:
+    template <class PrimaryArg, class SecondaryArg>
+    TLSFFallbackAllocator(PrimaryArg&& primaryAllocator, SecondaryArg&& secondaryAllocator)
+        : mPrimary(std::forward<PrimaryArg>(primaryAllocator))
+        , mSecondary(std::forward<SecondaryArg>(secondaryAllocator))
+    {
+    }
+
+    // 部品を値で持つときに構築引数をタプルで渡す
+    template <class... PrimaryArgs, class... SecondaryArgs>
+    TLSFFallbackAllocator(std::piecewise_construct_t, std::tuple<PrimaryArgs...> primaryArgs, std::tuple<SecondaryArgs...> secondaryArgs)
+        : mPrimary(std::make_from_tuple<Primary>(std::move(primaryArgs)))
+        , mSecondary(std::make_from_tuple<Secondary>(std::move(secondaryArgs)))
+    {
+    }
+
+    std::byte* allocate(uint32_t size)
+    {
+        std::byte* p = mPrimary.allocate(size);
+        return p ? p : mSecondary.allocate(size);
+    }
+
+    bool deallocate(void* address)
+    {
+        return mPrimary.owns(address) ? mPrimary.deallocate(address) : mSecondary.deallocate(address);
+    }
+
+    bool owns(const void* address) const
+    {
+        return mPrimary.owns(address) || mSecondary.owns(address);
+    }
+
+    Primary& getPrimary() { return mPrimary; }
+    Secondary& getSecondary() { return mSecondary; }
+
+private:
+    Primary mPrimary;
+    Secondary mSecondary;
+};
+
+#endif
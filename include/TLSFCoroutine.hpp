@@ -0,0 +1,86 @@
+﻿#ifndef _HEADER_ONLY_TLSFCOROUTINE_HPP_
+#define _HEADER_ONLY_TLSFCOROUTINE_HPP_
+
+// C++20のコルーチンフレームをTLSFAllocatorから確保するためのヘルパ
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+// promise_typeに継承させるミックスイン
+// コルーチンの先頭引数 (メンバ関数ならthisの次) に std::allocator_arg, Allocator& を渡すと
+// フレームがそのアロケータから確保される. 渡さなければグローバルのoperator newを使う
+//
+//   struct promise_type : TLSFPromiseAllocator<TLSFAllocator<>> { ... };
+//   Task run(std::allocator_arg_t, TLSFAllocator<>& allocator, int arg);
+//   run(std::allocator_arg, allocator, 42);
+template <class Allocator>
+struct TLSFPromiseAllocator
+{
+    template <typename... Args>
+    static void* operator new(std::size_t size, std::allocator_arg_t, Allocator& allocator, const Args&...)
+    {
+        return allocateFrame(size, &allocator);
+    }
+
+    // メンバ関数のコルーチン用
+    template <typename Class, typename... Args>
+    static void* operator new(std::size_t size, const Class&, std::allocator_arg_t, Allocator& allocator, const Args&...)
+    {
+        return allocateFrame(size, &allocator);
+    }
+
+    static void* operator new(std::size_t size)
+    {
+        return allocateFrame(size, nullptr);
+    }
+
+    // フレームの手前に保存したアロケータを取り出して解放
+    // ポインタだけで解放できるので, サイズ付きとサイズ無しのどちらを選ばれても同じ処理になる
+    static void operator delete(void* frame)
+    {
+        std::byte* memory = static_cast<std::byte*>(frame) - kHeaderSize;
+        Allocator* allocator = *reinterpret_cast<Allocator**>(memory);
+        if (allocator)
+        {
+            allocator->deallocate(memory);
+        }
+        else
+        {
+            ::operator delete(memory);
+        }
+    }
+
+    static void operator delete(void* frame, std::size_t)
+    {
+        operator delete(frame);
+    }
+
+private:
+    // フレームの前にアロケータへのポインタを置く. operator newと同じアラインメントを保つ分だけ空ける
+    static constexpr std::size_t kHeaderSize = sizeof(Allocator*) > __STDCPP_DEFAULT_NEW_ALIGNMENT__ ? sizeof(Allocator*) : __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    // 確保に失敗したらnew式と同じくstd::bad_allocを投げる
+    static void* allocateFrame(std::size_t size, Allocator* allocator)
+    {
+        void* memory = nullptr;
+        if (allocator)
+        {
+            memory = size + kHeaderSize <= UINT32_MAX ? allocator->allocate(static_cast<uint32_t>(size + kHeaderSize)) : nullptr;
+            if (!memory)
+            {
+                throw std::bad_alloc();
+            }
+        }
+        else
+        {
+            memory = ::operator new(size + kHeaderSize);
+        }
+
+        *reinterpret_cast<Allocator**>(memory) = allocator;
+        return static_cast<std::byte*>(memory) + kHeaderSize;
+    }
+};
+
+#endif
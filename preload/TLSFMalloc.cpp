@@ -0,0 +1,484 @@
+﻿#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "TLSFAllocator.hpp"
+
+// malloc family on top of TLSFAllocator, for LD_PRELOAD:
+//   LD_PRELOAD=./libtlsfmalloc.so ./your_binary
+// set TLSF_MALLOC_STATS=1 to print the heap statistics to stderr at exit.
+// set TLSF_MALLOC_HUGEPAGES=1 to back the pools with 2 MiB pages: MAP_HUGETLB
+// when the hugetlb pool can hold them, otherwise 2 MiB aligned mappings with
+// madvise(MADV_HUGEPAGE). malloc_trim() returns free memory to the OS in
+// whole 2 MiB ranges in that mode so it never splits a huge page.
+//
+// small and medium requests go to one TLSFAllocator whose pools are
+// anonymous mmap regions (grown through a failure handler), large requests
+// are mapped directly. every entry point takes one global mutex.
+
+namespace
+{
+using Allocator = TLSFAllocator<>;
+
+constexpr size_t kMainPoolSize = size_t(1) << 30;   // reserved up front, committed by the OS on first touch
+constexpr size_t kGrowPoolSize = size_t(256) << 20;
+constexpr size_t kDirectSize   = size_t(32) << 20;  // requests from this size are mapped directly
+constexpr size_t kHugePageSize = size_t(2) << 20;
+constexpr uint32_t kPoolNum    = 64;
+
+// placed in front of a directly mapped allocation
+struct DirectHeader
+{
+    void* base;
+    size_t mapSize;
+};
+static_assert(sizeof(DirectHeader) <= Allocator::kAlignment, "direct header breaks alignment");
+
+struct Counter
+{
+    uint64_t mallocNum;
+    uint64_t freeNum;
+    uint64_t directNum;
+    uint64_t directSize;
+    uint64_t failedNum;
+    uint64_t trimmedSize;
+};
+
+pthread_mutex_t gMutex = PTHREAD_MUTEX_INITIALIZER;
+alignas(Allocator) unsigned char gAllocatorStorage[sizeof(Allocator)];
+Allocator* gAllocator = nullptr;
+uint32_t gPoolNum = 0;
+bool gHugePages  = false;
+Counter gCounter;
+
+class LockGuard
+{
+public:
+    LockGuard() { pthread_mutex_lock(&gMutex); }
+    ~LockGuard() { pthread_mutex_unlock(&gMutex); }
+};
+
+size_t getPageSize()
+{
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return pageSize;
+}
+
+void* mapMemory(size_t size)
+{
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return memory == MAP_FAILED ? nullptr : memory;
+}
+
+// granularity of pool sizes and of the ranges malloc_trim() gives back
+size_t getPoolGranularity()
+{
+    return gHugePages ? kHugePageSize : getPageSize();
+}
+
+// size must be a multiple of kHugePageSize
+void* mapHugeMemory(size_t size)
+{
+#ifdef MAP_HUGETLB
+    // no MAP_NORESERVE: an unreserved hugetlb mapping would fault with SIGBUS once the pool runs dry
+    void* hugetlbMemory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (hugetlbMemory != MAP_FAILED)
+    {
+        return hugetlbMemory;
+    }
+#endif
+
+    // transparent huge pages: over-map, cut the region down to 2 MiB alignment and ask for huge pages
+    auto* base = static_cast<std::byte*>(mapMemory(size + kHugePageSize));
+    if (!base)
+    {
+        return nullptr;
+    }
+
+    auto* memory          = reinterpret_cast<std::byte*>((reinterpret_cast<uintptr_t>(base) + kHugePageSize - 1) & ~(kHugePageSize - 1));
+    const size_t headSize = static_cast<size_t>(memory - base);
+    if (headSize)
+    {
+        munmap(base, headSize);
+    }
+    munmap(memory + size, kHugePageSize - headSize);
+#ifdef MADV_HUGEPAGE
+    madvise(memory, size, MADV_HUGEPAGE);
+#endif
+    return memory;
+}
+
+void* mapPool(size_t size)
+{
+    return gHugePages ? mapHugeMemory(size) : mapMemory(size);
+}
+
+// failure handler: maps one more pool, mmap memory starts zeroed
+bool growPool(Allocator& allocator, uint32_t size, void*)
+{
+    if (gPoolNum >= kPoolNum)
+    {
+        return false;
+    }
+
+    const size_t needSize = static_cast<size_t>(size) + Allocator::kPoolOverhead + sizeof(BoundaryBlock<TLSFBlockHeader>) + sizeof(uint32_t);
+    const size_t poolSize = (needSize > kGrowPoolSize ? needSize + getPoolGranularity() - 1 : kGrowPoolSize) & ~(getPoolGranularity() - 1);
+    auto* memory          = static_cast<std::byte*>(mapPool(poolSize));
+    if (!memory)
+    {
+        return false;
+    }
+
+    if (!allocator.addPool(memory, static_cast<uint32_t>(poolSize), true))
+    {
+        munmap(memory, poolSize);
+        return false;
+    }
+
+    gPoolNum += 1;
+    return true;
+}
+
+// called with gMutex held
+Allocator* getAllocator()
+{
+    if (gAllocator)
+    {
+        return gAllocator;
+    }
+
+    const char* env = getenv("TLSF_MALLOC_HUGEPAGES");
+    gHugePages      = env && *env && *env != '0';
+
+    auto* memory = static_cast<std::byte*>(mapPool(kMainPoolSize));
+    if (!memory)
+    {
+        return nullptr;
+    }
+
+    // the control block must not come from operator new, which would call back into malloc
+    gAllocator = new (gAllocatorStorage) Allocator(memory, static_cast<uint32_t>(kMainPoolSize), kTLSFControlInPool | kTLSFZeroedMemory);
+    gAllocator->addFailureHandler(growPool);
+    gPoolNum += 1;
+    return gAllocator;
+}
+
+bool isPoolMemory(void* p)
+{
+    return gAllocator && gAllocator->owns(p);
+}
+
+DirectHeader* getDirectHeader(void* p)
+{
+    return reinterpret_cast<DirectHeader*>(static_cast<std::byte*>(p) - sizeof(DirectHeader));
+}
+
+// maps a region large enough to align the returned pointer and keep the header in front of it
+void* allocateDirect(size_t size, size_t alignment)
+{
+    const size_t align = alignment > Allocator::kAlignment ? alignment : Allocator::kAlignment;
+    if (size > SIZE_MAX - align - sizeof(DirectHeader) - getPageSize())
+    {
+        return nullptr;
+    }
+
+    const size_t mapSize = (size + align + sizeof(DirectHeader) + getPageSize() - 1) & ~(getPageSize() - 1);
+    auto* base           = static_cast<std::byte*>(mapMemory(mapSize));
+    if (!base)
+    {
+        return nullptr;
+    }
+
+    auto* p             = reinterpret_cast<std::byte*>((reinterpret_cast<uintptr_t>(base) + sizeof(DirectHeader) + align - 1) & ~(align - 1));
+    *getDirectHeader(p) = { base, mapSize };
+    gCounter.directNum += 1;
+    gCounter.directSize += mapSize;
+    return p;
+}
+
+void freeDirect(void* p)
+{
+    const DirectHeader header = *getDirectHeader(p);
+    gCounter.directNum -= 1;
+    gCounter.directSize -= header.mapSize;
+    munmap(header.base, header.mapSize);
+}
+
+size_t getUsableSize(void* p)
+{
+    if (isPoolMemory(p))
+    {
+        return gAllocator->usableSize(p);
+    }
+
+    const DirectHeader& header = *getDirectHeader(p);
+    return header.mapSize - static_cast<size_t>(static_cast<std::byte*>(p) - static_cast<std::byte*>(header.base));
+}
+
+// called with gMutex held
+void* allocateLocked(size_t size, size_t alignment, bool zeroed)
+{
+    gCounter.mallocNum += 1;
+
+    void* p = nullptr;
+    if (size < kDirectSize && alignment < kDirectSize - size)
+    {
+        if (Allocator* allocator = getAllocator())
+        {
+            const auto size32 = static_cast<uint32_t>(size);
+            if (alignment > Allocator::kAlignment)
+            {
+                p = allocator->allocateAligned(size32, static_cast<uint32_t>(alignment));
+                if (p && zeroed)
+                {
+                    std::memset(p, 0, size);
+                }
+            }
+            else
+            {
+                p = zeroed ? allocator->allocateZeroed(size32) : allocator->allocate(size32);
+            }
+        }
+    }
+    else
+    {
+        p = allocateDirect(size, alignment);
+    }
+
+    if (!p)
+    {
+        gCounter.failedNum += 1;
+    }
+    return p;
+}
+
+// called with gMutex held
+void freeLocked(void* p)
+{
+    gCounter.freeNum += 1;
+    if (isPoolMemory(p))
+    {
+        gAllocator->deallocate(p);
+    }
+    else
+    {
+        freeDirect(p);
+    }
+}
+
+void* allocateAligned(size_t size, size_t alignment)
+{
+    LockGuard lock;
+    void* p = allocateLocked(size, alignment, false);
+    if (!p)
+    {
+        errno = ENOMEM;
+    }
+    return p;
+}
+
+bool isValidAlignment(size_t alignment)
+{
+    return alignment && (alignment & (alignment - 1)) == 0;
+}
+
+// keep the heap consistent across fork()
+void lockForFork()
+{
+    pthread_mutex_lock(&gMutex);
+}
+
+void unlockForFork()
+{
+    pthread_mutex_unlock(&gMutex);
+}
+
+__attribute__((constructor)) void initialize()
+{
+    pthread_atfork(lockForFork, unlockForFork, unlockForFork);
+}
+
+// formats into a stack buffer and writes it with write(2) so nothing here allocates
+__attribute__((destructor)) void printStatistics()
+{
+    const char* env = getenv("TLSF_MALLOC_STATS");
+    if (!env || !*env || *env == '0')
+    {
+        return;
+    }
+
+    LockGuard lock;
+    TLSFStatistics stats;
+    if (gAllocator)
+    {
+        gAllocator->flushDeferred();
+        stats = gAllocator->getStatistics();
+    }
+
+    char buffer[640];
+    const int length = snprintf(buffer, sizeof(buffer),
+                                "tlsfmalloc: malloc %llu, free %llu, failed %llu, pools %u\n"
+                                "tlsfmalloc: used %llu bytes in %u blocks, free %llu bytes in %u blocks, largest free %u, footprint %llu\n"
+                                "tlsfmalloc: direct %llu mappings, %llu bytes\n"
+                                "tlsfmalloc: huge pages %s, trimmed %llu bytes\n",
+                                static_cast<unsigned long long>(gCounter.mallocNum), static_cast<unsigned long long>(gCounter.freeNum),
+                                static_cast<unsigned long long>(gCounter.failedNum), gPoolNum,
+                                static_cast<unsigned long long>(stats.usedSize), stats.usedBlockNum,
+                                static_cast<unsigned long long>(stats.freeSize), stats.freeBlockNum, stats.maxFreeSize,
+                                static_cast<unsigned long long>(stats.footprint),
+                                static_cast<unsigned long long>(gCounter.directNum), static_cast<unsigned long long>(gCounter.directSize),
+                                gHugePages ? "on" : "off", static_cast<unsigned long long>(gCounter.trimmedSize));
+    if (length > 0)
+    {
+        const ssize_t result = write(STDERR_FILENO, buffer, static_cast<size_t>(length) < sizeof(buffer) ? length : sizeof(buffer) - 1);
+        (void)result;
+    }
+}
+}  // namespace
+
+extern "C"
+{
+void* malloc(size_t size)
+{
+    return allocateAligned(size, 0);
+}
+
+void free(void* p)
+{
+    if (!p)
+    {
+        return;
+    }
+
+    LockGuard lock;
+    freeLocked(p);
+}
+
+void* calloc(size_t num, size_t size)
+{
+    if (size && num > SIZE_MAX / size)
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    LockGuard lock;
+    void* p = allocateLocked(num * size, 0, true);
+    if (!p)
+    {
+        errno = ENOMEM;
+    }
+    return p;
+}
+
+void* realloc(void* p, size_t size)
+{
+    if (!p)
+    {
+        return malloc(size);
+    }
+    if (!size)
+    {
+        free(p);
+        return nullptr;
+    }
+
+    LockGuard lock;
+    const size_t usableSize = getUsableSize(p);
+    if (size <= usableSize)
+    {
+        return p;
+    }
+
+    void* newP = allocateLocked(size, 0, false);
+    if (!newP)
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    std::memcpy(newP, p, usableSize);
+    freeLocked(p);
+    return newP;
+}
+
+int posix_memalign(void** p, size_t alignment, size_t size)
+{
+    if (!isValidAlignment(alignment) || alignment % sizeof(void*))
+    {
+        return EINVAL;
+    }
+
+    LockGuard lock;
+    void* result = allocateLocked(size, alignment, false);
+    if (!result)
+    {
+        return ENOMEM;
+    }
+
+    *p = result;
+    return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    if (!isValidAlignment(alignment))
+    {
+        errno = EINVAL;
+        return nullptr;
+    }
+    return allocateAligned(size, alignment);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    return aligned_alloc(alignment, size);
+}
+
+void* valloc(size_t size)
+{
+    return allocateAligned(size, getPageSize());
+}
+
+void* pvalloc(size_t size)
+{
+    return allocateAligned((size + getPageSize() - 1) & ~(getPageSize() - 1), getPageSize());
+}
+
+// gives the free pool memory back to the OS, pad is ignored
+int malloc_trim(size_t)
+{
+    LockGuard lock;
+    if (!gAllocator)
+    {
+        return 0;
+    }
+
+    gAllocator->flushDeferred();
+    // only ranges the kernel actually dropped count as trimmed
+    uint64_t trimmedSize = 0;
+    gAllocator->forEachFreeRange(static_cast<uint32_t>(getPoolGranularity()), [&](std::byte* begin, size_t size) {
+        if (madvise(begin, size, MADV_DONTNEED) == 0)
+        {
+            trimmedSize += size;
+        }
+    });
+    gCounter.trimmedSize += trimmedSize;
+    return trimmedSize ? 1 : 0;
+}
+
+size_t malloc_usable_size(void* p)
+{
+    if (!p)
+    {
+        return 0;
+    }
+
+    LockGuard lock;
+    return getUsableSize(p);
+}
+}
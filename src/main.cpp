@@ -1,10 +1,12 @@
 ﻿#include <bitset>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <random>
 #include <vector>
 
 #include "TLSFAllocator.hpp"
+#include "TLSFComposite.hpp"
 
 template <typename T>
 struct TestArray
@@ -68,10 +70,33 @@ void freeTest(TLSFAllocator<>& allocator, std::vector<TestArray<T>>& data)
     data.clear();
 }
 
-void checkAllCleared(void* mainMemory)
+void checkAllCleared(TLSFAllocator<>& allocator)
 {
-    auto* p = reinterpret_cast<BoundaryBlock<TLSFBlockHeader>*>(mainMemory);
-    std::cerr << "check size : " << p->header.getSize() << "\n";
+    const auto stats = allocator.getStatistics();
+    std::cerr << "check size : " << stats.maxFreeSize << "\n";
+    assert(stats.usedBlockNum == 0 && stats.freeBlockNum == 1);
+}
+
+// failure handler: hands out one spare pool
+bool addSparePool(TLSFAllocator<>& allocator, uint32_t size, void* userData)
+{
+    auto** spare = reinterpret_cast<std::byte**>(userData);
+    if (!*spare)
+    {
+        return false;
+    }
+
+    std::cerr << "add spare pool for size : " << size << "\n";
+    allocator.addPool(*spare, 4096);
+    *spare = nullptr;
+    return true;
+}
+
+// failure handler: reports success without adding any memory
+bool countFailure(TLSFAllocator<>&, uint32_t, void* userData)
+{
+    ++*reinterpret_cast<uint32_t*>(userData);
+    return true;
 }
 
 int main()
@@ -79,6 +104,7 @@ int main()
     constexpr size_t maxSize          = 8192;
     constexpr size_t surplusBlockSize = sizeof(TLSFBlockHeader) + sizeof(uint32_t);
     std::byte* mainmemory             = new std::byte[maxSize];
+    std::byte* spareMemory            = new std::byte[4096];
     {
         TLSFAllocator allocator(mainmemory, maxSize);
 
@@ -99,7 +125,7 @@ int main()
         auto* p2 = allocator.allocate<uint32_t>(10);
         auto* p3 = allocator.allocate<uint32_t>(10);
         allocator.deallocate(p2);
-        auto* p4 = allocator.allocate<uint32_t>(10);
+        [[maybe_unused]] auto* p4 = allocator.allocate<uint32_t>(10);
 
         const auto r = rand() % 10;
         p2[r]        = 0xdeadbeef;
@@ -116,9 +142,524 @@ int main()
             assert(p5[i] == i);
         }
 
+        // deferred coalescing
+        allocator.clearAll();
+        allocator.setDeferredCoalescing(1024);
+        {
+            std::vector<TestArray<uint32_t>> data;
+            uint32_t testTime = 40;
+            for (size_t time = 0; time < 100; ++time)
+            {
+                allocTest<uint32_t>(allocator, data, maxSize - surplusBlockSize * testTime, testTime);
+                freeTest<uint32_t>(allocator, data);
+            }
+            allocator.flushDeferred();
+            checkAllCleared(allocator);
+        }
+        allocator.setDeferredCoalescing(0);
+        std::cerr << "deferred coalescing test clear\n";
+
+        // hot-size exact-fit lists
+        allocator.clearAll();
+        allocator.setHotSizeCache(16);
+        {
+            std::vector<std::byte*> blocks;
+            std::mt19937 engine(3);
+            for (size_t time = 0; time < 20000; ++time)
+            {
+                if (blocks.size() < 16 && (engine() % 2 || blocks.empty()))
+                {
+                    // mostly two sizes, sometimes something else
+                    const uint32_t size = engine() % 8 ? (engine() % 2 ? 48 : 200) : 16 + engine() % 200;
+                    auto* p             = allocator.allocate(size);
+                    assert(p);
+                    std::memset(p, 0xff, size);
+                    blocks.push_back(p);
+                }
+                else
+                {
+                    const size_t i = engine() % blocks.size();
+                    allocator.deallocate(blocks[i]);
+                    blocks[i] = blocks.back();
+                    blocks.pop_back();
+                }
+            }
+            for (auto* p : blocks)
+            {
+                allocator.deallocate(p);
+            }
+            assert(allocator.getStatistics().hotCachedSize > 0);
+            allocator.flushDeferred();
+            checkAllCleared(allocator);
+        }
+        allocator.setHotSizeCache(0);
+        std::cerr << "hot size cache test clear\n";
+
+        // failure handler
+        allocator.clearAll();
+        {
+            std::byte* spare = spareMemory;
+            allocator.addFailureHandler(addSparePool, &spare);
+
+            auto* big = allocator.allocate(maxSize / 2);
+            assert(big);
+            [[maybe_unused]] auto* big2 = allocator.allocate(maxSize / 2);
+            assert(!big2);
+            assert(!spare);
+            // the rest of the main memory and the spare pool
+            auto* small  = allocator.allocate(2048);
+            auto* small2 = allocator.allocate(2048);
+            assert(small && small2);
+            assert(!allocator.allocate(2048));
+            // one of them lives in the added pool
+            assert(allocator.owns(small) && allocator.owns(small2));
+            assert(!allocator.owns(spareMemory + 4096));
+
+            allocator.deallocate(small);
+            allocator.deallocate(small2);
+            allocator.deallocate(big);
+            allocator.removeFailureHandler(addSparePool, &spare);
+            allocator.clearAll();
+        }
+        // a handler that claims success without freeing anything is not called forever
+        {
+            uint32_t callNum = 0;
+            allocator.addFailureHandler(countFailure, &callNum);
+            auto* big = allocator.allocate(maxSize / 2);
+            assert(big && !allocator.allocate(maxSize / 2));
+            assert(callNum == TLSFAllocator<>::kFailureRetryNum);
+            allocator.deallocate(big);
+            allocator.removeFailureHandler(countFailure, &callNum);
+        }
+        std::cerr << "failure handler test clear\n";
+
+        // per-tag budget
+        {
+            allocator.setTagBudget(1, 1024);
+            std::vector<std::byte*> tagged;
+            while (auto* p = allocator.allocate(100, 1))
+            {
+                tagged.push_back(p);
+            }
+            assert(!tagged.empty());
+            assert(allocator.getTagUsedSize(1) <= 1024 && allocator.getTagUsedSize(1) + 100 > 1024);
+            assert(allocator.getTagUsedSize(0) == 0);
+
+            // other tags are not affected
+            auto* other = allocator.allocate(2048);
+            assert(other && allocator.getTagUsedSize(0) >= 2048);
+            allocator.deallocate(other);
+
+            for (auto* p : tagged)
+            {
+                allocator.deallocate(p);
+            }
+            assert(allocator.getTagUsedSize(0) == 0 && allocator.getTagUsedSize(1) == 0);
+            allocator.setTagBudget(1, 0);
+            assert(allocator.getStatistics().usedBlockNum == 0);
+        }
+        std::cerr << "tag budget test clear\n";
+
+        // aligned allocation
+        {
+            std::vector<std::byte*> aligned;
+            for (uint32_t alignment = 16; alignment <= 1024; alignment *= 2)
+            {
+                auto* p = allocator.allocateAligned(100, alignment);
+                assert(p && reinterpret_cast<uintptr_t>(p) % alignment == 0);
+                std::memset(p, 0xff, 100);
+                aligned.push_back(p);
+            }
+            for (auto* p : aligned)
+            {
+                allocator.deallocate(p);
+            }
+            assert(allocator.getStatistics().usedBlockNum == 0);
+
+            // tiny aligned requests still leave a block of the smallest size class
+            // on configurations whose minimum block is larger than the default
+            auto alignedSmallTest = [](auto& heap, uint32_t minBlockSize) {
+                for (uint32_t offset = 0; offset <= 128; offset += 4)
+                {
+                    for (uint32_t alignment = 32; alignment <= 1024; alignment *= 2)
+                    {
+                        for (uint32_t size = 1; size <= 40; size += 13)
+                        {
+                            // vary where the searched block starts, then free the aligned block between used neighbours
+                            auto* spacer = offset ? heap.allocate(offset) : nullptr;
+                            auto* p      = heap.allocateAligned(size, alignment);
+                            auto* guard  = heap.allocate(16);
+                            assert(p && guard && reinterpret_cast<uintptr_t>(p) % alignment == 0);
+                            assert(heap.usableSize(p) >= minBlockSize);
+                            std::memset(p, 0xff, size);
+                            heap.deallocate(p);
+                            heap.deallocate(guard);
+                            if (spacer)
+                            {
+                                heap.deallocate(spacer);
+                            }
+                            assert(heap.getStatistics().usedBlockNum == 0 && heap.getStatistics().freeBlockNum == 1);
+                        }
+                    }
+                }
+            };
+            constexpr uint32_t heapSize = 64 * 1024;
+            std::byte* heapMemory       = new std::byte[heapSize];
+            {
+                TLSFAllocator<5> heap(heapMemory, heapSize);
+                alignedSmallTest(heap, 32);
+            }
+            {
+                TLSFAllocator<4, TLSFGoodFit, 64> heap(heapMemory, heapSize);
+                alignedSmallTest(heap, 64);
+            }
+            delete[] heapMemory;
+        }
+        std::cerr << "aligned allocation test clear\n";
+
+        // size feedback
+        {
+            for (uint32_t size = 1; size < 200; size += 7)
+            {
+                const auto result = allocator.allocateAtLeast(size);
+                assert(result.ptr && result.count >= size);
+                assert(allocator.usableSize(result.ptr) == result.count);
+                std::memset(result.ptr, 0xff, result.count);
+                allocator.deallocate(result.ptr);
+            }
+            auto* p = allocator.allocate(1);
+            assert(allocator.usableSize(p) >= 1);
+            allocator.deallocate(p);
+            assert(allocator.getStatistics().usedBlockNum == 0);
+        }
+        std::cerr << "allocate at least test clear\n";
+
         std::cerr << "end test\n";
     }
 
+    // control block placed in the managed memory
+    {
+        TLSFAllocator allocator(mainmemory, maxSize, kTLSFControlInPool);
+
+        std::vector<TestArray<uint32_t>> data;
+        uint32_t testTime = 10;
+        for (size_t time = 0; time < 100; ++time)
+        {
+            allocTest<uint32_t>(allocator, data, maxSize / 2, testTime);
+            freeTest<uint32_t>(allocator, data);
+        }
+        std::cerr << "control in pool test clear\n";
+    }
+
+    // child heaps carved from a parent
+    {
+        constexpr uint32_t parentSize = 1u << 20;
+        std::byte* parentMemory       = new std::byte[parentSize];
+        {
+            TLSFAllocator parent(parentMemory, parentSize);
+            for (size_t time = 0; time < 10; ++time)
+            {
+                auto* child = parent.createChild(16384, 8192);
+                assert(child);
+                [[maybe_unused]] const auto parentUsed = parent.getStatistics().usedSize;
+
+                std::vector<TestArray<uint32_t>> data;
+                allocTest<uint32_t>(*child, data, 32768, 16);
+                // the child had to grow from the parent
+                assert(parent.getStatistics().usedBlockNum > 1 && parent.getStatistics().usedSize > parentUsed);
+                freeTest<uint32_t>(*child, data);
+
+                child->clearAll();
+                allocTest<uint32_t>(*child, data, 32768, 16);
+                data.clear();
+
+                // dropped without freeing each object
+                TLSFAllocator<>::destroyChild(child);
+                checkAllCleared(parent);
+            }
+
+            // requests larger than growSize still get a chunk the child can use
+            {
+                auto* child = parent.createChild(16384, 4096);
+                assert(child);
+                auto* p  = child->allocate(10000);
+                auto* p2 = child->allocate(10000);
+                assert(p && p2);
+                // the object with the first region and one grown chunk
+                assert(parent.getStatistics().usedBlockNum == 2);
+                std::memset(p2, 0xff, 10000);
+                child->deallocate(p);
+                child->deallocate(p2);
+                TLSFAllocator<>::destroyChild(child);
+                checkAllCleared(parent);
+            }
+        }
+        delete[] parentMemory;
+        std::cerr << "child heap test clear\n";
+    }
+
+    // composed allocators
+    {
+        TLSFAllocator<3> small(mainmemory, maxSize / 2);
+        TLSFAllocator<> large(mainmemory + maxSize / 2, maxSize / 2);
+        TLSFAllocator<> overflow(spareMemory, 4096);
+        assert(small.owns(mainmemory + maxSize / 2 - 1) && !small.owns(mainmemory + maxSize / 2));
+        assert(large.owns(mainmemory + maxSize / 2) && !large.owns(spareMemory));
+
+        using Large = TLSFFallbackAllocator<TLSFAllocator<>&, TLSFAllocator<>&>;
+        TLSFSegregator<128, TLSFAllocator<3>&, Large> heap(small, Large(large, overflow));
+
+        auto* p = heap.allocate(64);
+        assert(p && small.owns(p));
+        std::vector<std::byte*> blocks;
+        while (auto* q = heap.allocate(512))
+        {
+            assert(large.owns(q) || overflow.owns(q));
+            blocks.push_back(q);
+        }
+        // the large heap ran out first, then the overflow heap took over
+        assert(overflow.owns(blocks.back()) && large.owns(blocks.front()));
+
+        for (auto* q : blocks)
+        {
+            assert(heap.owns(q));
+            heap.deallocate(q);
+        }
+        heap.deallocate(p);
+        assert(small.getStatistics().usedBlockNum == 0);
+        checkAllCleared(large);
+        checkAllCleared(overflow);
+
+        // requests over the primary's max size fail quietly and go to the secondary
+        {
+            constexpr uint32_t secondarySize = 64 * 1024;
+            std::byte* secondaryMemory       = new std::byte[secondarySize];
+            {
+                TLSFAllocator<> secondary(secondaryMemory, secondarySize);
+                using Fallback = TLSFFallbackAllocator<TLSFAllocator<>&, TLSFAllocator<>&>;
+                Fallback fallback(overflow, secondary);
+                auto* big = fallback.allocate(8000);
+                assert(big && secondary.owns(big));
+                fallback.deallocate(big);
+
+                TLSFSegregator<128, TLSFAllocator<3>&, Fallback> segregated(small, Fallback(overflow, secondary));
+                auto* big2 = segregated.allocate(8000);
+                auto* tiny = segregated.allocate(16);
+                assert(big2 && secondary.owns(big2) && tiny && small.owns(tiny));
+                segregated.deallocate(big2);
+                segregated.deallocate(tiny);
+                checkAllCleared(secondary);
+                checkAllCleared(overflow);
+            }
+            delete[] secondaryMemory;
+        }
+        std::cerr << "composite test clear\n";
+    }
+
+    // free ranges handed back to the OS
+    {
+        TLSFAllocator allocator(mainmemory, maxSize);
+
+        std::vector<std::byte*> blocks;
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            blocks.push_back(allocator.allocate(300 + i * 100));
+            assert(blocks.back());
+            std::memset(blocks.back(), static_cast<int>(i), 300 + i * 100);
+        }
+        for (uint32_t i = 0; i < 8; i += 2)
+        {
+            allocator.deallocate(blocks[i]);
+        }
+
+        uint64_t rangeSize = 0;
+        [[maybe_unused]] const auto trimmed = allocator.forEachFreeRange(1024, [&](std::byte* begin, size_t size) {
+            assert(reinterpret_cast<uintptr_t>(begin) % 1024 == 0 && size % 1024 == 0);
+            // the OS may hand the pages back with any content
+            std::memset(begin, 0xcc, size);
+            rangeSize += size;
+        });
+        assert(trimmed == rangeSize && trimmed > 0);
+        assert(allocator.forEachFreeRange(1u << 20, [](std::byte*, size_t) { assert(!"no range that large"); }) == 0);
+
+        for (uint32_t i = 1; i < 8; i += 2)
+        {
+            for (uint32_t j = 0; j < 300 + i * 100; ++j)
+            {
+                assert(blocks[i][j] == static_cast<std::byte>(i));
+            }
+            allocator.deallocate(blocks[i]);
+        }
+        checkAllCleared(allocator);
+        std::cerr << "free range test clear\n";
+    }
+
+    // lifetime hints: long-lived blocks in front, short-lived blocks at the back
+    {
+        TLSFAllocator allocator(mainmemory, maxSize);
+
+        std::vector<std::byte*> longBlocks;
+        std::vector<std::byte*> shortBlocks;
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            longBlocks.push_back(allocator.allocate(100 + i * 16, TLSFLifetimeHint::Long));
+            shortBlocks.push_back(allocator.allocate(200 - i * 16, TLSFLifetimeHint::Short));
+            assert(longBlocks.back() && shortBlocks.back());
+        }
+        for ([[maybe_unused]] auto* l : longBlocks)
+        {
+            for ([[maybe_unused]] auto* s : shortBlocks)
+            {
+                assert(l < s);
+            }
+        }
+
+        // freed short-lived blocks fall back into the untouched area instead of leaving holes
+        [[maybe_unused]] const auto freeBlockNum = allocator.getStatistics().freeBlockNum;
+        for (auto* s : shortBlocks)
+        {
+            allocator.deallocate(s);
+        }
+        assert(allocator.getStatistics().freeBlockNum == freeBlockNum);
+
+        std::mt19937 engine(3);
+        std::uniform_int_distribution<uint32_t> dist(16, 256);
+        shortBlocks.clear();
+        for (size_t time = 0; time < 10000; ++time)
+        {
+            if (shortBlocks.size() < 8 && engine() % 2)
+            {
+                if (auto* p = allocator.allocate(dist(engine), TLSFLifetimeHint::Short))
+                {
+                    shortBlocks.push_back(p);
+                }
+            }
+            else if (!shortBlocks.empty())
+            {
+                const size_t index = engine() % shortBlocks.size();
+                allocator.deallocate(shortBlocks[index]);
+                shortBlocks[index] = shortBlocks.back();
+                shortBlocks.pop_back();
+            }
+            if (time % 1000 == 0)
+            {
+                allocator.deallocate(longBlocks.back());
+                longBlocks.back() = allocator.allocate(dist(engine), TLSFLifetimeHint::Long);
+                assert(longBlocks.back());
+            }
+        }
+
+        for (auto* s : shortBlocks)
+        {
+            allocator.deallocate(s);
+        }
+        for (auto* l : longBlocks)
+        {
+            allocator.deallocate(l);
+        }
+        checkAllCleared(allocator);
+        std::cerr << "lifetime hint test clear\n";
+    }
+
+    // relocatable handles and incremental compaction
+    {
+        TLSFAllocator allocator(mainmemory, maxSize);
+
+        std::mt19937 engine(2);
+        std::uniform_int_distribution<uint32_t> dist(16, 128);
+        std::vector<TLSFAllocator<>::Handle> handles;
+        std::vector<uint32_t> sizes;
+        std::byte* raw = nullptr;
+        for (size_t i = 0; i < 40; ++i)
+        {
+            // a raw block stays in place
+            if (i == 10)
+            {
+                raw = allocator.allocate(64);
+            }
+
+            const uint32_t size = dist(engine);
+            const auto handle   = allocator.allocateHandle(size);
+            assert(handle != TLSFAllocator<>::kInvalidHandle);
+            std::memset(allocator.pin(handle), static_cast<int>(handle), size);
+            allocator.unpin(handle);
+            handles.push_back(handle);
+            sizes.push_back(size);
+        }
+        // so does a pinned handle
+        [[maybe_unused]] auto* pinned = allocator.pin(handles[21]);
+        for (size_t i = 0; i < handles.size(); i += 2)
+        {
+            allocator.deallocateHandle(handles[i]);
+            handles[i] = TLSFAllocator<>::kInvalidHandle;
+        }
+        const auto before = allocator.getStatistics();
+
+        uint32_t steps = 0;
+        while (allocator.compactStep(256))
+        {
+            ++steps;
+            assert(steps < 10000);
+        }
+        const auto after = allocator.getStatistics();
+        std::cerr << "compaction : free blocks " << before.freeBlockNum << " -> " << after.freeBlockNum << ", largest free "
+                  << before.maxFreeSize << " -> " << after.maxFreeSize << ", steps " << steps << "\n";
+        // holes are left only in front of the handle table, the pinned block and the raw block
+        assert(after.freeBlockNum <= 4 && after.maxFreeSize > before.maxFreeSize);
+        assert(allocator.pin(handles[21]) == pinned);
+        allocator.unpin(handles[21]);
+        allocator.unpin(handles[21]);
+
+        for (size_t i = 1; i < handles.size(); i += 2)
+        {
+            [[maybe_unused]] const auto* p = allocator.pin(handles[i]);
+            for (uint32_t j = 0; j < sizes[i]; ++j)
+            {
+                assert(p[j] == static_cast<std::byte>(handles[i]));
+            }
+            allocator.unpin(handles[i]);
+            allocator.deallocateHandle(handles[i]);
+        }
+        allocator.deallocate(raw);
+        std::cerr << "handle test clear\n";
+    }
+
+    // zeroed allocation from memory that starts zeroed
+    {
+        std::memset(mainmemory, 0, maxSize);
+        TLSFAllocator allocator(mainmemory, maxSize, kTLSFZeroedMemory);
+
+        std::mt19937 engine(1);
+        std::uniform_int_distribution<uint32_t> dist(1, maxSize / 8);
+        for (size_t time = 0; time < 1000; ++time)
+        {
+            std::byte* p[4];
+            uint32_t size[4];
+            for (size_t i = 0; i < 4; ++i)
+            {
+                size[i] = dist(engine);
+                p[i]    = (time + i) % 2 ? allocator.allocateZeroed(size[i]) : allocator.allocate(size[i]);
+                assert(p[i]);
+                for (uint32_t j = 0; (time + i) % 2 && j < size[i]; ++j)
+                {
+                    assert(p[i][j] == std::byte{ 0 });
+                }
+                std::memset(p[i], 0xff, size[i]);
+            }
+            allocator.deallocate(p[time % 4]);
+            allocator.deallocate(p[(time + 2) % 4]);
+            allocator.deallocate(p[(time + 1) % 4]);
+            allocator.deallocate(p[(time + 3) % 4]);
+            if (time % 10 == 0)
+            {
+                allocator.clearAll();
+            }
+        }
+        checkAllCleared(allocator);
+        std::cerr << "zeroed allocation test clear\n";
+    }
+
+    delete[] spareMemory;
     delete[] mainmemory;
 
     std::cerr << "clear main memory\n";